@@ -0,0 +1,1769 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks of request and answer handling. Answers are those of an
+ * emulated headset, recorded in a capture and received again by replaying
+ * it, as a device would send them */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "zikemulator.h"
+#include "zikcapture.h"
+#include "zikinfo.h"
+#include "zikapi.h"
+#include "zikscan.h"
+#include "zik2/zik2.h"
+#include "zik3/zik3.h"
+
+static gint iterations = 10000;
+static gint round_trips = 50;
+static gchar *model_name = NULL;
+static gchar *capture_path = NULL;
+
+static ZikEmulatorModel model;
+
+static GOptionEntry entries[] = {
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Number of times answers are handled", "N" },
+  { "round-trips", 'r', 0, G_OPTION_ARG_INT, &round_trips, "Number of round trips timed over shaped links", "N" },
+  { "model", 'm', 0, G_OPTION_ARG_STRING, &model_name, "Headset to take answers from", "<zik2|zik3>" },
+  { "capture", 0, 0, G_OPTION_ARG_FILENAME, &capture_path, "Keep capture of the session answers are taken from", "FILE" },
+  { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *description;
+  gboolean (*run) (GPtrArray * answers);
+} Benchmark;
+
+/* allocations are counted by the thread making them, through glibc
+ * allocator entry points, which sanitizers replace */
+#if defined (__GLIBC__) && !defined (__SANITIZE_ADDRESS__)
+#define COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static __thread guint allocations;
+
+void *
+malloc (size_t size)
+{
+  allocations++;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  allocations++;
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  allocations++;
+  return __libc_realloc (ptr, size);
+}
+#endif
+
+/* emulated metadata, long and not only ASCII like real ones */
+static const struct
+{
+  const gchar *key;
+  const gchar *value;
+} metadata[] = {
+  { "playing", "true" },
+  { "title", "Sehnsucht nach dem Frühling (Komm, lieber Mai, und mache), "
+        "KV 596 - Live at the Großer Musikvereinssaal" },
+  { "artist", "Wiener Sängerknaben & Chorus Viennensis" },
+  { "album", "Mozart: Lieder, Kanons & Kinderlieder (Remastered 2015)" },
+  { "genre", "Classical" },
+};
+
+static void
+ignore_log (const gchar * domain, GLogLevelFlags level, const gchar * message,
+    gpointer userdata)
+{
+}
+
+static gdouble
+elapsed_ns (gint64 start)
+{
+  return (g_get_monotonic_time () - start) * 1000.0;
+}
+
+/* get requests of every readable path of @model */
+static GPtrArray *
+make_requests (ZikEmulatorModel model)
+{
+  GPtrArray *requests;
+  guint models;
+  guint i;
+
+  requests = g_ptr_array_new_with_free_func ((GDestroyNotify) zik_message_free);
+  models = model == ZIK_EMULATOR_MODEL_ZIK2 ? ZIK_MODEL_ZIK2 : ZIK_MODEL_ZIK3;
+
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    if (zik_api_paths[i].get && (zik_api_paths[i].models & models))
+      g_ptr_array_add (requests,
+          zik_message_new_request (zik_api_paths[i].path, "get", NULL));
+  }
+
+  return requests;
+}
+
+/* send @requests in turn, answers being added to @answers if not NULL */
+static gboolean
+run_session (ZikConnection * conn, GPtrArray * requests, GPtrArray * answers)
+{
+  guint i;
+
+  if (!zik_connection_open_session (conn))
+    return FALSE;
+
+  for (i = 0; i < requests->len; i++) {
+    ZikMessage *answer;
+
+    if (!zik_connection_send_message (conn, g_ptr_array_index (requests, i),
+            &answer))
+      return FALSE;
+
+    if (answers)
+      g_ptr_array_add (answers, answer);
+    else
+      zik_message_free (answer);
+  }
+
+  return TRUE;
+}
+
+/* Record a session with an emulated headset to @path then replay it.
+ * Return: answers received from replay */
+static GPtrArray *
+load_answers (ZikEmulatorModel model, const gchar * path)
+{
+  GMainContext *context;
+  ZikEmulator *emu;
+  ZikCapture *capture;
+  ZikConnection *conn;
+  ZikTransport *transport;
+  GPtrArray *requests;
+  GPtrArray *answers = NULL;
+  GError *error = NULL;
+  gboolean ret;
+  guint i;
+
+  context = g_main_context_new ();
+  requests = make_requests (model);
+
+  capture = zik_capture_new (path, &error);
+  if (capture == NULL) {
+    g_printerr ("failed to start capture: %s\n", error->message);
+    g_error_free (error);
+    goto out;
+  }
+
+  emu = zik_emulator_new (model);
+  for (i = 0; i < G_N_ELEMENTS (metadata); i++)
+    zik_emulator_set_state (emu, metadata[i].key, metadata[i].value);
+
+  conn = zik_emulator_connect (emu, context);
+  zik_connection_set_capture (conn, capture);
+  ret = run_session (conn, requests, NULL);
+  zik_connection_unref (conn);
+  zik_emulator_unref (emu);
+  zik_capture_unref (capture);
+
+  if (!ret) {
+    g_printerr ("failed to record session\n");
+    goto out;
+  }
+
+  transport = zik_transport_new_for_capture (path, FALSE, &error);
+  if (transport == NULL) {
+    g_printerr ("failed to load capture: %s\n", error->message);
+    g_error_free (error);
+    goto out;
+  }
+
+  answers = g_ptr_array_new_with_free_func ((GDestroyNotify) zik_message_free);
+  conn = zik_connection_new_for_transport (transport, context);
+  ret = run_session (conn, requests, answers);
+  zik_connection_unref (conn);
+  zik_transport_unref (transport);
+
+  if (!ret) {
+    g_printerr ("failed to replay session\n");
+    g_ptr_array_unref (answers);
+    answers = NULL;
+  }
+
+out:
+  g_ptr_array_unref (requests);
+  g_main_context_unref (context);
+
+  return answers;
+}
+
+static gsize
+answers_size (GPtrArray * answers)
+{
+  gsize total = 0;
+  guint i;
+
+  for (i = 0; i < answers->len; i++) {
+    gsize size;
+
+    zik_message_peek_request_reply_xml (g_ptr_array_index (answers, i),
+        &size);
+    total += size;
+  }
+
+  return total;
+}
+
+/** parity */
+
+static gboolean
+infos_equal (const ZikElementSpec * spec, gconstpointer a, gconstpointer b)
+{
+  guint i;
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    const guint8 *fa = (const guint8 *) a + spec->attrs[i].offset;
+    const guint8 *fb = (const guint8 *) b + spec->attrs[i].offset;
+
+    switch (spec->attrs[i].type) {
+      case ZIK_ATTR_STRING:
+      case ZIK_ATTR_INTERNED:
+        if (g_strcmp0 (*(const gchar **) fa, *(const gchar **) fb) != 0)
+          return FALSE;
+        break;
+      case ZIK_ATTR_BOOLEAN:
+      case ZIK_ATTR_INT:
+      case ZIK_ATTR_ENUM:
+        if (*(const gint *) fa != *(const gint *) fb)
+          return FALSE;
+        break;
+      case ZIK_ATTR_IGNORED:
+        break;
+    }
+  }
+
+  return TRUE;
+}
+
+/* same infos in the same order for every element */
+static gboolean
+replies_equal (ZikRequestReplyData * a, ZikRequestReplyData * b)
+{
+  ZikElementId id;
+
+  for (id = ZIK_ELEMENT_ANY + 1; id < ZIK_N_ELEMENTS; id++) {
+    const ZikElementSpec *spec = &zik_element_specs[id];
+    gpointer ia;
+    gpointer ib;
+
+    ia = zik_request_reply_data_find_node_info (a, spec->get_type ());
+    ib = zik_request_reply_data_find_node_info (b, spec->get_type ());
+
+    while (ia && ib) {
+      if (!infos_equal (spec, ia, ib))
+        return FALSE;
+
+      ia = zik_request_reply_data_find_next_node_info (a, ia);
+      ib = zik_request_reply_data_find_next_node_info (b, ib);
+    }
+
+    if (ia || ib)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Return: whether tokenizer and GMarkup parse @xml the same way */
+static gboolean
+check_parity (const gchar * xml, gsize size)
+{
+  ZikMessage *msg;
+  ZikRequestReplyData *replies[2] = { NULL, NULL };
+  gboolean ok[2];
+  gboolean ret;
+  ZikElementId id;
+  guint i;
+
+  msg = zik_message_new_request_reply (xml, size);
+
+  for (i = 0; i < 2; i++) {
+    zik_message_set_strict_xml (i == 1);
+    ok[i] = zik_message_parse_request_reply (msg, &replies[i]);
+  }
+
+  ret = ok[0] == ok[1] && (!ok[0] || replies_equal (replies[0], replies[1]));
+
+  for (i = 0; i < 2; i++) {
+    if (ok[i])
+      zik_request_reply_data_free (replies[i]);
+  }
+
+  /* targeted parse of every info type */
+  for (id = ZIK_ELEMENT_ANY + 1; ret && id < ZIK_N_ELEMENTS; id++) {
+    const ZikElementSpec *spec = &zik_element_specs[id];
+    gpointer infos[2] = { NULL, NULL };
+    gboolean errors[2] = { FALSE, FALSE };
+
+    for (i = 0; i < 2; i++) {
+      zik_message_set_strict_xml (i == 1);
+      ok[i] = zik_message_parse_request_reply_info (msg, spec->get_type (),
+          &infos[i], &errors[i]);
+    }
+
+    ret = ok[0] == ok[1] && errors[0] == errors[1] &&
+        (infos[0] == NULL) == (infos[1] == NULL) &&
+        (infos[0] == NULL || infos_equal (spec, infos[0], infos[1]));
+
+    for (i = 0; i < 2; i++) {
+      if (infos[i])
+        g_boxed_free (spec->get_type (), infos[i]);
+    }
+  }
+
+  zik_message_set_strict_xml (FALSE);
+  zik_message_free (msg);
+
+  return ret;
+}
+
+/* Return: (transfer full): @xml with @insert put after first occurrence of
+ * @after, NULL if there is none */
+static gchar *
+insert_after (const gchar * xml, gsize size, const gchar * after,
+    const gchar * insert)
+{
+  const gchar *at;
+  GString *str;
+
+  at = g_strstr_len (xml, size, after);
+  if (at == NULL)
+    return NULL;
+
+  at += strlen (after);
+  str = g_string_new_len (xml, at - xml);
+  g_string_append (str, insert);
+  g_string_append_len (str, at, xml + size - at);
+
+  return g_string_free (str, FALSE);
+}
+
+/* Return: (transfer full): @xml with every @from byte replaced */
+static gchar *
+replace_bytes (const gchar * xml, gsize size, const gchar * from,
+    const gchar * to)
+{
+  GString *str;
+  gsize i;
+
+  str = g_string_sized_new (size);
+  for (i = 0; i < size; i++) {
+    const gchar *c = strchr (from, xml[i]);
+
+    if (c)
+      g_string_append (str, to);
+    else
+      g_string_append_c (str, xml[i]);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+typedef struct
+{
+  guint index;
+  guint n_checks;
+  guint n_failures;
+} ParityStats;
+
+static void
+count_parity (ParityStats * stats, const gchar * xml, gsize size)
+{
+  stats->n_checks++;
+
+  if (!check_parity (xml, size)) {
+    stats->n_failures++;
+    g_printerr ("parity: answer %u differs: %.*s\n", stats->index,
+        (gint) size, xml);
+  }
+}
+
+/* Variants of recorded answers, some only GMarkup handles and some no one
+ * does, all should be parsed the same either way */
+static gboolean
+bench_parity (GPtrArray * answers)
+{
+  static const struct
+  {
+    const gchar *after;
+    const gchar *insert;
+  } insertions[] = {
+    /* entities decoded by tokenizer */
+    { "=\"", "&amp;&lt;&#233;&#x1F3B5;" },
+    /* entities left to GMarkup */
+    { "=\"", "&nbsp;" },
+    { "=\"", "&#0;" },
+    /* invalid UTF-8 */
+    { "=\"", "\xc3" },
+    { "=\"", "\xff" },
+    { "<?xml", "\xfe" },
+    /* text and markup the tokenizer does not handle */
+    { "<answer", "><!-- comment --" },
+    { "<answer", ">text<x/" },
+    { "<answer", "><![CDATA[data]]><x/" },
+    /* malformed */
+    { "<answer", " path" },
+    { "<answer", " a=\"1\" a=\"2\"" },
+    { "\"", "\"" },
+    { "</", "x" },
+  };
+  static const struct
+  {
+    const gchar *from;
+    const gchar *to;
+  } replacements[] = {
+    /* spacing between elements and around attributes */
+    { ">", ">\n\t " },
+    { "=", " = " },
+    { "\"", "'" },
+  };
+  ParityStats stats = { 0, };
+  guint j;
+
+  for (stats.index = 0; stats.index < answers->len; stats.index++) {
+    const gchar *xml;
+    gsize size;
+    gchar *variant;
+
+    xml = zik_message_peek_request_reply_xml (
+        g_ptr_array_index (answers, stats.index), &size);
+
+    count_parity (&stats, xml, size);
+
+    /* truncated */
+    for (j = 1; j < 4; j++)
+      count_parity (&stats, xml, size * j / 4);
+
+    for (j = 0; j < G_N_ELEMENTS (replacements); j++) {
+      variant = replace_bytes (xml, size, replacements[j].from,
+          replacements[j].to);
+      count_parity (&stats, variant, strlen (variant));
+      g_free (variant);
+    }
+
+    for (j = 0; j < G_N_ELEMENTS (insertions); j++) {
+      variant = insert_after (xml, size, insertions[j].after,
+          insertions[j].insert);
+      if (variant) {
+        count_parity (&stats, variant, strlen (variant));
+        g_free (variant);
+      }
+    }
+  }
+
+  g_print ("parity: %u answers, %u checks, %u failures\n", answers->len,
+      stats.n_checks, stats.n_failures);
+
+  return stats.n_failures == 0;
+}
+
+/** parse */
+
+/* Return: time to parse and free a reply of each answer, in ns */
+static gdouble
+time_parse (GPtrArray * answers)
+{
+  gint64 start;
+  gint n;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < answers->len; i++) {
+      ZikRequestReplyData *reply;
+
+      if (!zik_message_parse_request_reply (g_ptr_array_index (answers, i),
+              &reply))
+        return -1.0;
+
+      zik_request_reply_data_free (reply);
+    }
+  }
+
+  return elapsed_ns (start);
+}
+
+/* Return: (transfer container): @answers which parse, those with
+ * attributes unknown to the schema don't */
+static GPtrArray *
+parsed_answers (GPtrArray * answers)
+{
+  GPtrArray *parsed;
+  guint i;
+
+  parsed = g_ptr_array_new ();
+  for (i = 0; i < answers->len; i++) {
+    ZikRequestReplyData *reply;
+
+    if (zik_message_parse_request_reply (g_ptr_array_index (answers, i),
+            &reply)) {
+      zik_request_reply_data_free (reply);
+      g_ptr_array_add (parsed, g_ptr_array_index (answers, i));
+    }
+  }
+
+  return parsed;
+}
+
+static gboolean
+bench_parse (GPtrArray * answers)
+{
+  GPtrArray *parsed;
+  gboolean ret = TRUE;
+  gsize size;
+  guint i;
+
+  parsed = parsed_answers (answers);
+  size = answers_size (parsed);
+
+  g_print ("parse: %u answers (%u skipped), %" G_GSIZE_FORMAT
+      " bytes of xml\n", parsed->len, answers->len - parsed->len, size);
+
+  for (i = 0; ret && i < 2; i++) {
+    gdouble t;
+
+    zik_message_set_strict_xml (i == 1);
+    t = time_parse (parsed);
+    zik_message_set_strict_xml (FALSE);
+    if (t < 0.0) {
+      g_printerr ("parse: failed to parse answers\n");
+      ret = FALSE;
+      break;
+    }
+
+    g_print ("  %-9s %8.0f ns/answer %8.1f MB/s\n",
+        i == 1 ? "gmarkup" : "tokenizer", t / iterations / parsed->len,
+        size * iterations / t * 1000.0);
+  }
+
+  g_ptr_array_unref (parsed);
+
+  return ret;
+}
+
+/** arena */
+
+/* Return: (transfer full): info types found in reply of each of @answers,
+ * <answer> being left out as no caller keeps it */
+static GPtrArray *
+answers_info_types (GPtrArray * answers)
+{
+  GPtrArray *types;
+  guint i;
+
+  types = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+
+  for (i = 0; i < answers->len; i++) {
+    ZikRequestReplyData *reply;
+    GArray *found;
+    ZikElementId id;
+
+    found = g_array_new (FALSE, FALSE, sizeof (GType));
+    g_ptr_array_add (types, found);
+
+    if (!zik_message_parse_request_reply (g_ptr_array_index (answers, i),
+            &reply))
+      continue;
+
+    for (id = ZIK_ELEMENT_ANY + 1; id < ZIK_N_ELEMENTS; id++) {
+      GType type = zik_element_specs[id].get_type ();
+
+      if (id != ZIK_ELEMENT_ANSWER &&
+          zik_request_reply_data_find_node_info (reply, type))
+        g_array_append_val (found, type);
+    }
+
+    zik_request_reply_data_free (reply);
+  }
+
+  return types;
+}
+
+/* Return: time to parse answers, copy out or steal first info of each of
+ * their @types, free reply and then infos, in ns */
+static gdouble
+time_keep_infos (GPtrArray * answers, GPtrArray * types, gboolean steal)
+{
+  gpointer kept[ZIK_N_ELEMENTS];
+  gint64 start;
+  gint n;
+  guint i;
+  guint j;
+
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < answers->len; i++) {
+      GArray *found = g_ptr_array_index (types, i);
+      ZikRequestReplyData *reply;
+
+      if (!zik_message_parse_request_reply (g_ptr_array_index (answers, i),
+              &reply))
+        return -1.0;
+
+      for (j = 0; j < found->len; j++) {
+        GType type = g_array_index (found, GType, j);
+
+        if (steal)
+          kept[j] = zik_request_reply_data_steal_node_info (reply, type);
+        else
+          kept[j] = zik_request_reply_data_copy_info (reply, type);
+      }
+
+      zik_request_reply_data_free (reply);
+
+      for (j = 0; j < found->len; j++)
+        g_boxed_free (g_array_index (found, GType, j), kept[j]);
+    }
+  }
+
+  return elapsed_ns (start);
+}
+
+/* Replies are freed at once, infos kept past them are copied out or stolen
+ * along with the reply memory */
+static gboolean
+bench_arena (GPtrArray * answers)
+{
+  GPtrArray *parsed;
+  GPtrArray *types;
+  gdouble arena;
+  gdouble copy_out;
+  gdouble steal;
+  gboolean ret = TRUE;
+  guint n_kept = 0;
+  guint i;
+
+  parsed = parsed_answers (answers);
+  types = answers_info_types (parsed);
+  for (i = 0; i < types->len; i++)
+    n_kept += ((GArray *) g_ptr_array_index (types, i))->len;
+
+  arena = time_parse (parsed);
+  copy_out = time_keep_infos (parsed, types, FALSE);
+  steal = time_keep_infos (parsed, types, TRUE);
+  if (arena < 0.0 || copy_out < 0.0 || steal < 0.0) {
+    g_printerr ("arena: failed to parse answers\n");
+    ret = FALSE;
+    goto out;
+  }
+
+  g_print ("arena: %u answers, %u infos kept\n", parsed->len, n_kept);
+  g_print ("  %-9s %8.0f ns/answer\n", "arena",
+      arena / iterations / parsed->len);
+  g_print ("  %-9s %8.0f ns/answer\n", "copy-out",
+      copy_out / iterations / parsed->len);
+  g_print ("  %-9s %8.0f ns/answer\n", "steal",
+      steal / iterations / parsed->len);
+
+out:
+  g_ptr_array_unref (types);
+  g_ptr_array_unref (parsed);
+
+  return ret;
+}
+
+/** scan */
+
+/* Return: time to find every quote, '<' and '&' of answers, in ns */
+static gdouble
+time_scan (GPtrArray * answers, guint * found)
+{
+  gint64 start;
+  gint n;
+  guint i;
+
+  *found = 0;
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < answers->len; i++) {
+      const gchar *p;
+      const gchar *end;
+      gsize size;
+
+      p = zik_message_peek_request_reply_xml (g_ptr_array_index (answers, i),
+          &size);
+      end = p + size;
+
+      while ((p = zik_scan3 (p, end, '"', '<', '&')) < end) {
+        (*found)++;
+        p++;
+      }
+    }
+  }
+
+  return elapsed_ns (start);
+}
+
+static gboolean
+bench_scan (GPtrArray * answers)
+{
+  static const gchar *kernels[] = { "scalar", "sse2", "avx2" };
+  const gchar *best = zik_scan_get_implementation ();
+  GPtrArray *parsed;
+  gsize size;
+  guint i;
+
+  parsed = parsed_answers (answers);
+  size = answers_size (parsed);
+
+  g_print ("scan: %u answers, %" G_GSIZE_FORMAT " bytes of xml, %s kernel "
+      "by default\n", parsed->len, size, best);
+
+  for (i = 0; i < G_N_ELEMENTS (kernels); i++) {
+    gdouble scan;
+    gdouble parse;
+    guint found;
+
+    if (!zik_scan_set_implementation (kernels[i])) {
+      g_print ("  %-7s not supported\n", kernels[i]);
+      continue;
+    }
+
+    scan = time_scan (parsed, &found);
+    parse = time_parse (parsed);
+
+    g_print ("  %-7s scan %8.1f MB/s %6u delimiters, parse %6.0f ns/answer\n",
+        kernels[i], size * iterations / scan * 1000.0, found / iterations,
+        parse / iterations / parsed->len);
+  }
+
+  zik_scan_set_implementation (best);
+  g_ptr_array_unref (parsed);
+
+  return TRUE;
+}
+
+/** incremental */
+
+/* Time to parse @answer fed in @chunk bytes pieces, @n_chunks of them if not
+ * all, finishing only if all are. @chunk 0 means not fed at all.
+ * Return: time per answer in ns */
+static gdouble
+time_feed (ZikMessage * answer, gsize chunk, gsize n_chunks)
+{
+  const gchar *payload;
+  gsize size;
+  gint64 start;
+  gint n;
+
+  payload = zik_message_peek_payload (answer, &size);
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    ZikReplyParser *parser;
+    ZikRequestReplyData *reply;
+    gsize pos;
+    gsize i;
+
+    parser = zik_reply_parser_new (G_TYPE_NONE);
+
+    for (pos = 0, i = 0; chunk && pos < size && i < n_chunks; i++) {
+      gsize len = MIN (chunk, size - pos);
+
+      pos += len;
+      zik_reply_parser_feed (parser, payload, pos);
+    }
+
+    if (pos == size || chunk == 0) {
+      if (!zik_reply_parser_finish_reply (parser, answer, &reply)) {
+        zik_reply_parser_free (parser);
+        return -1.0;
+      }
+      zik_request_reply_data_free (reply);
+    }
+
+    zik_reply_parser_free (parser);
+  }
+
+  return elapsed_ns (start) / iterations;
+}
+
+/* Largest answer fed as it would be received. Time after last byte is what
+ * is left to do once the end of the answer is there */
+static gboolean
+bench_incremental (GPtrArray * answers)
+{
+  static const gsize chunks[] = { 16, 64, 256 };
+  ZikMessage *answer = NULL;
+  gsize size = 0;
+  gdouble t;
+  guint i;
+
+  for (i = 0; i < answers->len; i++) {
+    ZikMessage *msg = g_ptr_array_index (answers, i);
+    gsize msg_size;
+
+    zik_message_peek_payload (msg, &msg_size);
+    if (msg_size > size) {
+      answer = msg;
+      size = msg_size;
+    }
+  }
+
+  if (answer == NULL)
+    return FALSE;
+
+  g_print ("incremental: %" G_GSIZE_FORMAT " bytes answer\n", size);
+
+  t = time_feed (answer, 0, 0);
+  if (t < 0.0)
+    goto failed;
+
+  g_print ("  %-10s %8.0f ns total %8.0f ns after last byte\n", "at finish",
+      t, t);
+
+  for (i = 0; i < G_N_ELEMENTS (chunks); i++) {
+    gsize n_chunks = (size + chunks[i] - 1) / chunks[i];
+    gdouble before;
+    gchar *name;
+
+    t = time_feed (answer, chunks[i], n_chunks);
+    before = time_feed (answer, chunks[i], n_chunks - 1);
+    if (t < 0.0)
+      goto failed;
+
+    name = g_strdup_printf ("%" G_GSIZE_FORMAT " bytes", chunks[i]);
+    g_print ("  %-10s %8.0f ns total %8.0f ns after last byte\n", name, t,
+        MAX (t - before, 0.0));
+    g_free (name);
+  }
+
+  return TRUE;
+
+failed:
+  g_printerr ("incremental: failed to parse answer\n");
+  return FALSE;
+}
+
+/** shaping */
+
+typedef struct
+{
+  ZikEmulator *emu;
+  ZikConnection *conn;
+  ZikTransport *link;
+  GMainContext *context;
+} ShapedSession;
+
+/* connection to an emulated headset whose received data is shaped, as
+ * zik-sim does, so that answers come one RTT after requests are sent */
+static gboolean
+shaped_session_open (ShapedSession * session,
+    const ZikTransportShaping * shaping)
+{
+  ZikTransport *transport;
+  ZikTransport *peer;
+
+  if (!zik_transport_new_socketpair (&transport, &peer))
+    return FALSE;
+
+  session->context = g_main_context_new ();
+  session->link = zik_transport_new_shaped (peer, shaping);
+  zik_transport_unref (peer);
+
+  session->emu = zik_emulator_new (model);
+  zik_emulator_serve (session->emu, session->link, session->context, NULL,
+      NULL);
+
+  session->conn = zik_connection_new_for_transport (transport,
+      session->context);
+  zik_transport_unref (transport);
+
+  return zik_connection_open_session (session->conn);
+}
+
+static void
+shaped_session_close (ShapedSession * session)
+{
+  zik_connection_unref (session->conn);
+  zik_emulator_unref (session->emu);
+  zik_transport_unref (session->link);
+  g_main_context_unref (session->context);
+}
+
+static gint
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db;
+}
+
+/* mean and standard deviation the configured delay should give */
+static void
+shaping_expected (const ZikTransportShaping * shaping, gdouble * mean,
+    gdouble * stddev)
+{
+  *mean = shaping->delay;
+  *stddev = 0.0;
+
+  switch (shaping->distribution) {
+    case ZIK_TRANSPORT_JITTER_UNIFORM:
+      *stddev = shaping->jitter / sqrt (3.0);
+      break;
+    case ZIK_TRANSPORT_JITTER_NORMAL:
+      *stddev = shaping->jitter;
+      break;
+    case ZIK_TRANSPORT_JITTER_EXPONENTIAL:
+      *mean += shaping->jitter;
+      *stddev = shaping->jitter;
+      break;
+  }
+}
+
+/* time round trips of a get request, in ms */
+static gboolean
+time_round_trips (const ZikTransportShaping * shaping, const gchar * name)
+{
+  ShapedSession session;
+  ZikMessage *request;
+  gdouble *rtts;
+  gdouble mean = 0.0;
+  gdouble var = 0.0;
+  gdouble expected_mean;
+  gdouble expected_stddev;
+  gboolean ret = TRUE;
+  gint i;
+
+  if (!shaped_session_open (&session, shaping)) {
+    g_printerr ("shaping: failed to open session\n");
+    shaped_session_close (&session);
+    return FALSE;
+  }
+
+  rtts = g_new (gdouble, round_trips);
+  request = zik_message_new_request (ZIK_API_AUDIO_VOLUME_PATH, "get", NULL);
+
+  for (i = 0; i < round_trips; i++) {
+    gint64 start = g_get_monotonic_time ();
+    ZikMessage *answer;
+
+    if (!zik_connection_send_message (session.conn, request, &answer)) {
+      ret = FALSE;
+      goto out;
+    }
+
+    rtts[i] = (g_get_monotonic_time () - start) / 1000.0;
+    mean += rtts[i];
+    zik_message_free (answer);
+  }
+
+  mean /= round_trips;
+  for (i = 0; i < round_trips; i++)
+    var += (rtts[i] - mean) * (rtts[i] - mean);
+
+  qsort (rtts, round_trips, sizeof (gdouble), compare_doubles);
+  shaping_expected (shaping, &expected_mean, &expected_stddev);
+
+  g_print ("  %-18s mean %6.1f (%6.1f) stddev %5.1f (%5.1f) p50 %6.1f "
+      "p95 %6.1f ms\n", name, mean, expected_mean, sqrt (var / round_trips),
+      expected_stddev, rtts[round_trips / 2], rtts[round_trips * 95 / 100]);
+
+out:
+  zik_message_free (request);
+  g_free (rtts);
+  shaped_session_close (&session);
+
+  return ret;
+}
+
+typedef struct
+{
+  guint pending;
+  gboolean failed;
+} PipelineData;
+
+static void
+on_pipelined_answer (GObject * source, GAsyncResult * res, gpointer userdata)
+{
+  PipelineData *data = userdata;
+  ZikMessage *answer;
+  GError *error = NULL;
+
+  answer = zik_connection_send_message_finish (NULL, res, &error);
+  if (answer)
+    zik_message_free (answer);
+  else {
+    data->failed = TRUE;
+    g_error_free (error);
+  }
+
+  data->pending--;
+}
+
+/* Return: time to send every one of @requests, in ms. @max_in_flight 0
+ * sends them one after the other */
+static gdouble
+time_properties (const ZikTransportShaping * shaping, GPtrArray * requests,
+    guint max_in_flight)
+{
+  ShapedSession session;
+  PipelineData data = { 0, FALSE };
+  gint64 start = 0;
+  guint i;
+
+  if (!shaped_session_open (&session, shaping)) {
+    data.failed = TRUE;
+    goto out;
+  }
+
+  start = g_get_monotonic_time ();
+
+  if (max_in_flight == 0) {
+    data.failed = !run_session (session.conn, requests, NULL);
+    goto out;
+  }
+
+  zik_connection_set_max_in_flight (session.conn, max_in_flight);
+
+  g_main_context_push_thread_default (session.context);
+  for (i = 0; i < requests->len; i++) {
+    data.pending++;
+    zik_connection_send_message_async (session.conn,
+        zik_message_copy (g_ptr_array_index (requests, i)), NULL,
+        on_pipelined_answer, &data);
+  }
+
+  while (data.pending > 0)
+    g_main_context_iteration (session.context, TRUE);
+  g_main_context_pop_thread_default (session.context);
+
+out:
+  shaped_session_close (&session);
+
+  return data.failed ? -1.0 : (g_get_monotonic_time () - start) / 1000.0;
+}
+
+/* Shaped link RTTs against the configured ones, then static properties
+ * got one at a time or pipelined */
+static gboolean
+bench_shaping (GPtrArray * answers)
+{
+  static const guint delays[] = { 30, 60, 120 };
+  static const guint in_flight[] = { 0, 2, 4, 8 };
+  static const struct
+  {
+    const gchar *name;
+    ZikTransportJitter distribution;
+  } jitters[] = {
+    { "uniform", ZIK_TRANSPORT_JITTER_UNIFORM },
+    { "normal", ZIK_TRANSPORT_JITTER_NORMAL },
+    { "exponential", ZIK_TRANSPORT_JITTER_EXPONENTIAL },
+  };
+  ZikTransportShaping shaping = { 0, };
+  GPtrArray *requests;
+  gboolean ret = TRUE;
+  guint i;
+  guint j;
+
+  g_print ("shaping: %d round trips, configured values in parentheses\n",
+      round_trips);
+
+  shaping.seed = 1;
+  for (i = 0; i < G_N_ELEMENTS (delays); i++) {
+    shaping.delay = delays[i];
+
+    for (j = 0; j < G_N_ELEMENTS (jitters); j++) {
+      gchar *name;
+      gboolean ret;
+
+      shaping.jitter = delays[i] / 6;
+      shaping.distribution = jitters[j].distribution;
+
+      name = g_strdup_printf ("%u+%u %s", shaping.delay, shaping.jitter,
+          jitters[j].name);
+      ret = time_round_trips (&shaping, name);
+      g_free (name);
+
+      if (!ret) {
+        g_printerr ("shaping: request failed\n");
+        return FALSE;
+      }
+    }
+  }
+
+  shaping.delay = 60;
+  shaping.jitter = 0;
+  requests = make_requests (model);
+  g_print ("shaping: %u properties over %u ms link\n", requests->len,
+      shaping.delay);
+
+  for (i = 0; ret && i < G_N_ELEMENTS (in_flight); i++) {
+    gdouble t = time_properties (&shaping, requests, in_flight[i]);
+
+    if (t < 0.0) {
+      g_printerr ("shaping: request failed\n");
+      ret = FALSE;
+      break;
+    }
+
+    if (in_flight[i] == 0)
+      g_print ("  %-18s %8.0f ms\n", "sequential", t);
+    else
+      g_print ("  %u in flight%-7s %8.0f ms\n", in_flight[i], "", t);
+  }
+
+  g_ptr_array_unref (requests);
+
+  return ret;
+}
+
+/** requests */
+
+/* Return: time to make and free a request with @method and @args on every
+ * one of @paths, in ns */
+static gdouble
+time_requests (GPtrArray * paths, const gchar * method, const gchar * args)
+{
+  gint64 start;
+  gint n;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < paths->len; i++)
+      zik_message_free (zik_message_new_request (g_ptr_array_index (paths, i),
+              method, args));
+  }
+
+  return elapsed_ns (start);
+}
+
+/* Requests of API paths without argument or with a boolean one are
+ * prebuilt, others are built from the prebuilt get request of the path, or
+ * from scratch for paths outside the API */
+static gboolean
+bench_requests (GPtrArray * answers)
+{
+  static const struct
+  {
+    const gchar *name;
+    const gchar *method;
+    const gchar *args;
+    gboolean api;
+  } kinds[] = {
+    { "get", "get", NULL, TRUE },
+    { "set bool", "set", "true", TRUE },
+    { "set arg", "set", "50", TRUE },
+    { "other get", "get", NULL, FALSE },
+    { "other set", "set", "50", FALSE },
+  };
+  GPtrArray *paths;
+  GPtrArray *others;
+  guint models;
+  guint i;
+
+  paths = g_ptr_array_new ();
+  others = g_ptr_array_new_with_free_func (g_free);
+  models = model == ZIK_EMULATOR_MODEL_ZIK2 ? ZIK_MODEL_ZIK2 : ZIK_MODEL_ZIK3;
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    if (zik_api_paths[i].models & models) {
+      g_ptr_array_add (paths, (gpointer) zik_api_paths[i].path);
+      g_ptr_array_add (others, g_strconcat ("/bench", zik_api_paths[i].path,
+              NULL));
+    }
+  }
+
+  g_print ("requests: %u paths\n", paths->len);
+  for (i = 0; i < G_N_ELEMENTS (kinds); i++) {
+    gdouble t = time_requests (kinds[i].api ? paths : others,
+        kinds[i].method, kinds[i].args);
+
+    g_print ("  %-9s %8.0f ns/request\n", kinds[i].name,
+        t / iterations / paths->len);
+  }
+
+  g_ptr_array_unref (others);
+  g_ptr_array_unref (paths);
+
+  return TRUE;
+}
+
+/** paths */
+
+/* Return: FALSE if a path isn't found back by both lookups, or if a
+ * truncated or unknown path is found */
+static gboolean
+check_paths (void)
+{
+  ZikApiPathId i;
+
+  if (zik_api_path_lookup ("/api/bench", strlen ("/api/bench")) !=
+      ZIK_API_PATH_UNKNOWN ||
+      zik_api_path_lookup_request ("get", strlen ("get")) !=
+      ZIK_API_PATH_UNKNOWN)
+    return FALSE;
+
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    const gchar *path = zik_api_paths[i].path;
+    gsize len = strlen (path);
+    ZikApiPathId j;
+    gchar *request;
+    gboolean ret;
+
+    request = g_strconcat (path, "/get", NULL);
+    ret = zik_api_path_lookup (path, len) == i &&
+        zik_api_path_lookup_request (request, strlen (request)) == i;
+    g_free (request);
+
+    if (!ret)
+      return FALSE;
+
+    /* unless it is another path */
+    for (j = 0; j < ZIK_N_API_PATHS; j++) {
+      if (strlen (zik_api_paths[j].path) == len - 1 &&
+          strncmp (zik_api_paths[j].path, path, len - 1) == 0)
+        break;
+    }
+
+    if (j == ZIK_N_API_PATHS)
+      j = ZIK_API_PATH_UNKNOWN;
+
+    if (zik_api_path_lookup (path, len - 1) != j)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Return: time to look up every one of @paths, in ns, with
+ * zik_api_path_lookup_request () if @requests or with @table if not NULL */
+static gdouble
+time_lookup (GPtrArray * paths, gboolean requests, GHashTable * table)
+{
+  gint64 start;
+  guint found = 0;
+  gint n;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for (n = 0; n < iterations; n++) {
+    for (i = 0; i < paths->len; i++) {
+      const gchar *path = g_ptr_array_index (paths, i);
+
+      if (table)
+        found += g_hash_table_contains (table, path);
+      else if (requests)
+        found += zik_api_path_lookup_request (path, strlen (path)) !=
+            ZIK_API_PATH_UNKNOWN;
+      else
+        found += zik_api_path_lookup (path, strlen (path)) !=
+            ZIK_API_PATH_UNKNOWN;
+    }
+  }
+
+  if (found != iterations * paths->len)
+    return -1.0;
+
+  return elapsed_ns (start);
+}
+
+/* Paths are found back from the ones in requests and answers, without
+ * hashing, as string keyed tables did before */
+static gboolean
+bench_paths (GPtrArray * answers)
+{
+  GPtrArray *paths;
+  GPtrArray *requests;
+  GHashTable *table;
+  gdouble lookup;
+  gdouble request;
+  gdouble hash;
+  guint i;
+
+  if (!check_paths ()) {
+    g_printerr ("paths: lookup failed\n");
+    return FALSE;
+  }
+
+  paths = g_ptr_array_new ();
+  requests = g_ptr_array_new_with_free_func (g_free);
+  table = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    g_ptr_array_add (paths, (gpointer) zik_api_paths[i].path);
+    g_ptr_array_add (requests, g_strconcat (zik_api_paths[i].path, "/get",
+            NULL));
+    g_hash_table_add (table, (gpointer) zik_api_paths[i].path);
+  }
+
+  lookup = time_lookup (paths, FALSE, NULL);
+  request = time_lookup (requests, TRUE, NULL);
+  hash = time_lookup (paths, FALSE, table);
+
+  g_print ("paths: %u paths\n", paths->len);
+  g_print ("  %-9s %8.1f ns/path\n", "lookup", lookup / iterations / paths->len);
+  g_print ("  %-9s %8.1f ns/path\n", "request",
+      request / iterations / paths->len);
+  g_print ("  %-9s %8.1f ns/path\n", "hash", hash / iterations / paths->len);
+
+  g_hash_table_unref (table);
+  g_ptr_array_unref (requests);
+  g_ptr_array_unref (paths);
+
+  return TRUE;
+}
+
+/** send */
+
+/* transport counting writes of the one it wraps */
+typedef struct
+{
+  ZikTransport parent;
+  ZikTransport *inner;
+  guint writes;
+} CountingTransport;
+
+static gssize
+counting_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error)
+{
+  CountingTransport *self = (CountingTransport *) transport;
+
+  self->writes++;
+  return zik_transport_send (self->inner, vectors, n_vectors, error);
+}
+
+static gssize
+counting_transport_receive (ZikTransport * transport, guint8 * buffer,
+    gsize size, GError ** error)
+{
+  CountingTransport *self = (CountingTransport *) transport;
+
+  return zik_transport_receive (self->inner, buffer, size, error);
+}
+
+static GSource *
+counting_transport_create_watch (ZikTransport * transport,
+    GIOCondition condition, ZikTransportWatchFunc func, gpointer userdata,
+    GDestroyNotify notify)
+{
+  CountingTransport *self = (CountingTransport *) transport;
+
+  return zik_transport_create_watch (self->inner, condition, func, userdata,
+      notify);
+}
+
+static void
+counting_transport_finalize (ZikTransport * transport)
+{
+  CountingTransport *self = (CountingTransport *) transport;
+
+  zik_transport_unref (self->inner);
+}
+
+static const ZikTransportFuncs counting_transport_funcs = {
+  .send = counting_transport_send,
+  .receive = counting_transport_receive,
+  .create_watch = counting_transport_create_watch,
+  .finalize = counting_transport_finalize
+};
+
+static gpointer
+serve_thread (gpointer userdata)
+{
+  GMainLoop *loop = userdata;
+
+  g_main_context_push_thread_default (g_main_loop_get_context (loop));
+  g_main_loop_run (loop);
+  g_main_context_pop_thread_default (g_main_loop_get_context (loop));
+
+  return NULL;
+}
+
+/* Send get requests of every readable path at once, @max_in_flight of them
+ * being pipelined, to an emulated headset served from another thread so
+ * that allocations of this one are those of the connection.
+ * Return: FALSE if a request failed */
+static gboolean
+count_send (GPtrArray * paths, guint max_in_flight)
+{
+  CountingTransport *counting;
+  PipelineData data = { 0, FALSE };
+  GMainContext *emu_context;
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  ZikEmulator *emu;
+  ZikConnection *conn;
+  ZikTransport *transport;
+  ZikTransport *peer;
+  guint queue_allocations = 0;
+  guint total_allocations = 0;
+  guint i;
+
+  if (!zik_transport_new_socketpair (&transport, &peer))
+    return FALSE;
+
+  emu_context = g_main_context_new ();
+  emu = zik_emulator_new (model);
+  zik_emulator_serve (emu, peer, emu_context, NULL, NULL);
+  zik_transport_unref (peer);
+
+  loop = g_main_loop_new (emu_context, FALSE);
+  thread = g_thread_new ("emulator", serve_thread, loop);
+
+  counting = zik_transport_new (&counting_transport_funcs,
+      sizeof (CountingTransport));
+  counting->inner = transport;
+
+  context = g_main_context_new ();
+  conn = zik_connection_new_for_transport ((ZikTransport *) counting,
+      context);
+  if (!zik_connection_open_session (conn)) {
+    data.failed = TRUE;
+    goto out;
+  }
+
+  zik_connection_set_max_in_flight (conn, max_in_flight);
+  counting->writes = 0;
+
+  g_main_context_push_thread_default (context);
+#ifdef COUNT_ALLOCATIONS
+  allocations = 0;
+#endif
+  for (i = 0; i < paths->len; i++) {
+    data.pending++;
+    zik_connection_send_message_async (conn,
+        zik_message_new_request (g_ptr_array_index (paths, i), "get", NULL),
+        NULL, on_pipelined_answer, &data);
+  }
+#ifdef COUNT_ALLOCATIONS
+  queue_allocations = allocations;
+#endif
+
+  while (data.pending > 0)
+    g_main_context_iteration (context, TRUE);
+#ifdef COUNT_ALLOCATIONS
+  total_allocations = allocations;
+#endif
+  g_main_context_pop_thread_default (context);
+
+  if (!data.failed) {
+    g_print ("  %2u in flight %5u writes %6.2f requests/write", max_in_flight,
+        counting->writes, (gdouble) paths->len / counting->writes);
+#ifdef COUNT_ALLOCATIONS
+    g_print (" %6.2f queued %6.2f total allocations/request",
+        (gdouble) queue_allocations / paths->len,
+        (gdouble) total_allocations / paths->len);
+#endif
+    g_print ("\n");
+  }
+
+out:
+  zik_connection_unref (conn);
+  zik_transport_unref ((ZikTransport *) counting);
+
+  g_main_loop_quit (loop);
+  g_thread_join (thread);
+  g_main_loop_unref (loop);
+  zik_emulator_unref (emu);
+  g_main_context_unref (emu_context);
+  g_main_context_unref (context);
+
+  return !data.failed;
+}
+
+/* Writes and allocations of requests sent in pipelined batches, allocations
+ * made while queueing them then until their answer is handled */
+static gboolean
+bench_send (GPtrArray * answers)
+{
+  static const guint in_flight[] = { 1, 4, 16 };
+  GPtrArray *paths;
+  gboolean ret = TRUE;
+  guint models;
+  guint i;
+
+  paths = g_ptr_array_new ();
+  models = model == ZIK_EMULATOR_MODEL_ZIK2 ? ZIK_MODEL_ZIK2 : ZIK_MODEL_ZIK3;
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    if (zik_api_paths[i].get && (zik_api_paths[i].models & models))
+      g_ptr_array_add (paths, (gpointer) zik_api_paths[i].path);
+  }
+
+  g_print ("send: %u get requests\n", paths->len);
+#ifndef COUNT_ALLOCATIONS
+  g_print ("  allocations are not counted in this build\n");
+#endif
+
+  for (i = 0; ret && i < G_N_ELEMENTS (in_flight); i++) {
+    if (!count_send (paths, in_flight[i])) {
+      g_printerr ("send: request failed\n");
+      ret = FALSE;
+    }
+  }
+
+  g_ptr_array_free (paths, TRUE);
+
+  return ret;
+}
+
+/** footprint */
+
+/* Return: resident set size in KiB, 0 if unknown */
+static glong
+resident_kib (void)
+{
+  gchar *contents;
+  glong size;
+  glong resident = 0;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return 0;
+
+  if (sscanf (contents, "%ld %ld", &size, &resident) != 2)
+    resident = 0;
+  g_free (contents);
+
+  return resident * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static Zik *
+footprint_device_new (ZikConnection * conn, guint n)
+{
+  gchar *address;
+  Zik *zik;
+
+  address = g_strdup_printf ("A0:14:3D:%02X:%02X:%02X", (n >> 16) & 0xff,
+      (n >> 8) & 0xff, n & 0xff);
+
+  if (model == ZIK_EMULATOR_MODEL_ZIK2)
+    zik = ZIK (zik2_new ("Parrot ZIK 2.0", address, zik_connection_ref (conn)));
+  else
+    zik = ZIK (zik3_new ("Parrot ZIK 3", address, zik_connection_ref (conn)));
+
+  g_free (address);
+
+  return zik;
+}
+
+/* Memory taken by devices once their static properties are synced, all of
+ * them sharing one emulated headset connection */
+static gboolean
+bench_footprint (GPtrArray * answers)
+{
+  static const guint counts[] = { 1000, 10000 };
+  GMainContext *context;
+  ZikEmulator *emu;
+  ZikConnection *conn;
+  GPtrArray *devices;
+  GTypeQuery query;
+  gboolean ret = TRUE;
+  glong base;
+  guint i;
+
+  context = g_main_context_new ();
+  emu = zik_emulator_new (model);
+  for (i = 0; i < G_N_ELEMENTS (metadata); i++)
+    zik_emulator_set_state (emu, metadata[i].key, metadata[i].value);
+
+  conn = zik_emulator_connect (emu, context);
+  if (!zik_connection_open_session (conn)) {
+    g_printerr ("footprint: failed to open session\n");
+    ret = FALSE;
+    goto out;
+  }
+
+  devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  /* types, interned strings and connection buffers are not per device */
+  g_ptr_array_add (devices, footprint_device_new (conn, 0));
+  base = resident_kib ();
+
+  g_type_query (G_OBJECT_TYPE (g_ptr_array_index (devices, 0)), &query);
+  g_print ("footprint: %s instance %u bytes, private data not included\n",
+      query.type_name, query.instance_size);
+
+  for (i = 0; i < G_N_ELEMENTS (counts); i++) {
+    glong kib;
+
+    while (devices->len <= counts[i])
+      g_ptr_array_add (devices, footprint_device_new (conn, devices->len));
+
+    kib = resident_kib () - base;
+    g_print ("  %5u devices %8ld KiB %8.0f bytes/device\n", counts[i], kib,
+        kib * 1024.0 / counts[i]);
+  }
+
+  g_ptr_array_unref (devices);
+
+out:
+  zik_connection_unref (conn);
+  zik_emulator_unref (emu);
+  g_main_context_unref (context);
+
+  return ret;
+}
+
+static const Benchmark benchmarks[] = {
+  { "parity", "compare tokenizer and GMarkup results", bench_parity },
+  { "parse", "reply parsing with tokenizer and GMarkup", bench_parse },
+  { "arena", "reply freeing and info copy-out", bench_arena },
+  { "scan", "delimiter scanning kernels", bench_scan },
+  { "incremental", "parsing while answer is received", bench_incremental },
+  { "shaping", "round trips over shaped links", bench_shaping },
+  { "requests", "request making and freeing", bench_requests },
+  { "paths", "API path lookups", bench_paths },
+  { "send", "writes and allocations of pipelined requests", bench_send },
+  { "footprint", "memory taken by devices", bench_footprint },
+};
+
+static const Benchmark *
+find_benchmark (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (benchmarks); i++) {
+    if (g_strcmp0 (benchmarks[i].name, name) == 0)
+      return &benchmarks[i];
+  }
+
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gint ret = EXIT_FAILURE;
+  GError *error = NULL;
+  GOptionContext *context;
+  GPtrArray *answers = NULL;
+  GString *summary;
+  gchar *path = NULL;
+  gint fd;
+  gint i;
+
+  context = g_option_context_new ("[BENCHMARK...] - benchmark request and "
+      "answer handling");
+  g_option_context_add_main_entries (context, entries, 0);
+
+  summary = g_string_new ("Benchmarks, all of them by default:");
+  for (i = 0; i < (gint) G_N_ELEMENTS (benchmarks); i++)
+    g_string_append_printf (summary, "\n  %-12s %s", benchmarks[i].name,
+        benchmarks[i].description);
+  g_option_context_set_summary (context, summary->str);
+  g_string_free (summary, TRUE);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("failed to parse options: %s\n", error->message);
+    g_error_free (error);
+    goto out;
+  }
+
+  if (iterations <= 0 || round_trips <= 0) {
+    g_printerr ("invalid 'iterations' or 'round-trips' value\n");
+    goto out;
+  }
+
+  if (model_name == NULL || g_strcmp0 (model_name, "zik3") == 0) {
+    model = ZIK_EMULATOR_MODEL_ZIK3;
+  } else if (g_strcmp0 (model_name, "zik2") == 0) {
+    model = ZIK_EMULATOR_MODEL_ZIK2;
+  } else {
+    g_printerr ("unrecognized 'model' value\n");
+    goto out;
+  }
+
+  for (i = 1; i < argc; i++) {
+    if (find_benchmark (argv[i]) == NULL) {
+      g_printerr ("unknown benchmark '%s'\n", argv[i]);
+      goto out;
+    }
+  }
+
+  if (capture_path) {
+    path = g_strdup (capture_path);
+  } else {
+    fd = g_file_open_tmp ("zik-bench-XXXXXX.cap", &path, &error);
+    if (fd < 0) {
+      g_printerr ("failed to create capture: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+    g_close (fd, NULL);
+  }
+
+  answers = load_answers (model, path);
+  if (answers == NULL)
+    goto out;
+
+  /* failures are expected while checking malformed answers */
+  g_log_set_handler (NULL, G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING,
+      ignore_log, NULL);
+
+  ret = EXIT_SUCCESS;
+  for (i = 0; i < (gint) G_N_ELEMENTS (benchmarks); i++) {
+    gint j;
+
+    for (j = 1; j < argc; j++) {
+      if (g_strcmp0 (argv[j], benchmarks[i].name) == 0)
+        break;
+    }
+
+    if (argc > 1 && j == argc)
+      continue;
+
+    if (!benchmarks[i].run (answers))
+      ret = EXIT_FAILURE;
+  }
+
+out:
+  if (answers)
+    g_ptr_array_unref (answers);
+
+  if (path && capture_path == NULL)
+    g_unlink (path);
+  g_free (path);
+
+  g_option_context_free (context);
+
+  return ret;
+}
@@ -0,0 +1,269 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Emulate Zik headsets on a UNIX socket, each client getting its own device,
+ * so that zik2ctl can be run without any bluetooth hardware */
+
+#include <stdlib.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+
+#include "zikemulator.h"
+
+static gchar *socket_path = NULL;
+static gchar *model_name = NULL;
+static gboolean short_answer_path = FALSE;
+static gboolean drop_unknown = FALSE;
+static gint delay = 0;
+static gint jitter = 0;
+static gchar *jitter_distribution = NULL;
+static gint bandwidth = 0;
+static gdouble split_probability = 0.0;
+static gint split_delay = 0;
+static gchar *latency_profile = NULL;
+static gint seed = 0;
+
+static GOptionEntry entries[] = {
+  { "socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_path, "Path of UNIX socket to listen on", "PATH" },
+  { "model", 'm', 0, G_OPTION_ARG_STRING, &model_name, "Headset to emulate", "<zik2|zik3>" },
+  { "short-answer-path", 0, 0, G_OPTION_ARG_NONE, &short_answer_path, "Answer with path lacking method", NULL },
+  { "drop-unknown", 0, 0, G_OPTION_ARG_NONE, &drop_unknown, "Never answer requests on unknown path", NULL },
+  { "delay", 0, 0, G_OPTION_ARG_INT, &delay, "Round-trip time in milliseconds", "MS" },
+  { "jitter", 0, 0, G_OPTION_ARG_INT, &jitter, "Jitter added to round-trip time in milliseconds", "MS" },
+  { "jitter-distribution", 0, 0, G_OPTION_ARG_STRING, &jitter_distribution, "Distribution of jitter", "<uniform|normal|exponential>" },
+  { "bandwidth", 0, 0, G_OPTION_ARG_INT, &bandwidth, "Link bandwidth in bytes per second", "BPS" },
+  { "split-probability", 0, 0, G_OPTION_ARG_DOUBLE, &split_probability, "Probability of a frame being split in two", "0.0-1.0" },
+  { "split-delay", 0, 0, G_OPTION_ARG_INT, &split_delay, "Delay between two parts of a split frame in milliseconds", "MS" },
+  { "latency-profile", 0, 0, G_OPTION_ARG_FILENAME, &latency_profile, "Replay round-trip times recorded from a device, one per line in milliseconds", "FILE" },
+  { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "Seed of jitter and split randomness", NULL },
+  { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+static ZikEmulatorModel model = ZIK_EMULATOR_MODEL_ZIK2;
+static ZikEmulatorQuirks quirks = ZIK_EMULATOR_QUIRK_NONE;
+static ZikTransportShaping shaping = { 0, };
+static gboolean shaped = FALSE;
+static guint n_clients = 0;
+
+static void
+on_client_closed (ZikEmulator * emu, gpointer userdata)
+{
+  g_print ("client %u disconnected\n", GPOINTER_TO_UINT (userdata));
+  zik_emulator_unref (emu);
+}
+
+static gboolean
+on_incoming (GSocket * listener, GIOCondition condition, gpointer userdata)
+{
+  ZikEmulator *emu;
+  ZikTransport *transport;
+  GSocket *socket;
+  GError *error = NULL;
+  gchar *serial;
+
+  socket = g_socket_accept (listener, NULL, &error);
+  if (socket == NULL) {
+    g_printerr ("failed to accept client: %s\n", error->message);
+    g_error_free (error);
+    return G_SOURCE_CONTINUE;
+  }
+
+  n_clients++;
+  g_print ("client %u connected\n", n_clients);
+
+  /* every client is a distinct headset */
+  emu = zik_emulator_new (model);
+  zik_emulator_set_quirks (emu, quirks);
+  serial = g_strdup_printf ("PI%015u", n_clients);
+  zik_emulator_set_state (emu, "pi", serial);
+  g_free (serial);
+
+  transport = zik_transport_new_for_socket (socket);
+  if (shaped) {
+    /* delaying requests delays answers by the same amount */
+    ZikTransport *link = zik_transport_new_shaped (transport, &shaping);
+
+    zik_transport_unref (transport);
+    transport = link;
+  }
+
+  zik_emulator_serve (emu, transport, NULL, on_client_closed,
+      GUINT_TO_POINTER (n_clients));
+
+  zik_transport_unref (transport);
+  g_object_unref (socket);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+setup_shaping (void)
+{
+  GError *error = NULL;
+
+  if (delay < 0 || jitter < 0 || bandwidth < 0 || split_delay < 0 ||
+      split_probability < 0.0 || split_probability > 1.0) {
+    g_printerr ("invalid link shaping value\n");
+    return FALSE;
+  }
+
+  if (jitter_distribution == NULL ||
+      g_strcmp0 (jitter_distribution, "uniform") == 0) {
+    shaping.distribution = ZIK_TRANSPORT_JITTER_UNIFORM;
+  } else if (g_strcmp0 (jitter_distribution, "normal") == 0) {
+    shaping.distribution = ZIK_TRANSPORT_JITTER_NORMAL;
+  } else if (g_strcmp0 (jitter_distribution, "exponential") == 0) {
+    shaping.distribution = ZIK_TRANSPORT_JITTER_EXPONENTIAL;
+  } else {
+    g_printerr ("unrecognized 'jitter-distribution' value\n");
+    return FALSE;
+  }
+
+  if (latency_profile) {
+    shaping.latency_profile =
+        zik_transport_load_latency_profile (latency_profile, &error);
+    if (shaping.latency_profile == NULL) {
+      g_printerr ("failed to load latency profile: %s\n", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+  }
+
+  shaping.delay = delay;
+  shaping.jitter = jitter;
+  shaping.bandwidth = bandwidth;
+  shaping.split_probability = split_probability;
+  shaping.split_delay = split_delay;
+  shaping.seed = seed;
+
+  shaped = delay || jitter || bandwidth || split_probability > 0.0 ||
+      shaping.latency_profile != NULL;
+
+  return TRUE;
+}
+
+static GSocket *
+listen_on (const gchar * path)
+{
+  GSocketAddress *address;
+  GSocket *socket;
+  GError *error = NULL;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_DEFAULT, &error);
+  if (socket == NULL) {
+    g_printerr ("failed to create socket: %s\n", error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  /* remove socket left by a previous run */
+  g_unlink (path);
+
+  address = g_unix_socket_address_new (path);
+  if (!g_socket_bind (socket, address, TRUE, &error) ||
+      !g_socket_listen (socket, &error)) {
+    g_printerr ("failed to listen on %s: %s\n", path, error->message);
+    g_error_free (error);
+    g_object_unref (address);
+    g_object_unref (socket);
+    return NULL;
+  }
+
+  g_object_unref (address);
+  g_socket_set_blocking (socket, FALSE);
+
+  return socket;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gint ret = EXIT_FAILURE;
+  GError *error = NULL;
+  GOptionContext *context;
+  GMainLoop *loop = NULL;
+  GSocket *listener = NULL;
+  GSource *source;
+
+  context = g_option_context_new ("- emulate Zik2/Zik3 headsets");
+  g_option_context_add_main_entries (context, entries, 0);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("failed to parse options: %s\n", error->message);
+    g_error_free (error);
+    goto out;
+  }
+
+  if (socket_path == NULL) {
+    g_printerr ("socket path shall be specified\n");
+    goto out;
+  }
+
+  if (model_name == NULL || g_strcmp0 (model_name, "zik2") == 0) {
+    model = ZIK_EMULATOR_MODEL_ZIK2;
+  } else if (g_strcmp0 (model_name, "zik3") == 0) {
+    model = ZIK_EMULATOR_MODEL_ZIK3;
+  } else {
+    g_printerr ("unrecognized 'model' value\n");
+    goto out;
+  }
+
+  if (short_answer_path)
+    quirks |= ZIK_EMULATOR_QUIRK_SHORT_ANSWER_PATH;
+
+  if (drop_unknown)
+    quirks |= ZIK_EMULATOR_QUIRK_DROP_UNKNOWN;
+
+  if (!setup_shaping ())
+    goto out;
+
+  listener = listen_on (socket_path);
+  if (listener == NULL)
+    goto out;
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  source = g_socket_create_source (listener, G_IO_IN, NULL);
+  g_source_set_callback (source, (GSourceFunc) (GCallback) on_incoming, NULL,
+      NULL);
+  g_source_attach (source, NULL);
+  g_source_unref (source);
+
+  g_print ("emulating %s on %s\n", model == ZIK_EMULATOR_MODEL_ZIK2 ?
+      "Zik2" : "Zik3", socket_path);
+  g_main_loop_run (loop);
+
+  ret = EXIT_SUCCESS;
+
+out:
+  if (loop)
+    g_main_loop_unref (loop);
+
+  if (listener) {
+    g_object_unref (listener);
+    g_unlink (socket_path);
+  }
+
+  if (shaping.latency_profile)
+    g_array_unref (shaping.latency_profile);
+
+  g_option_context_free (context);
+
+  return ret;
+}
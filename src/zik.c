@@ -56,41 +56,93 @@ enum
   PROP_TTS,
 };
 
-struct _ZikPrivate
+/* variable strings of a device, packed in a single block */
+typedef enum
 {
-  gchar *name;
-  gchar *address;
+  ZIK_STRING_NAME,
+  ZIK_STRING_ADDRESS,
+  ZIK_STRING_SOFTWARE_VERSION,
+  ZIK_STRING_SERIAL,
+  /* the name used to generate the real bluetooth name */
+  ZIK_STRING_FRIENDLYNAME,
+
+  ZIK_N_STRINGS
+} ZikString;
+
+/* offset of unset strings */
+#define ZIK_STRING_NONE G_MAXUINT16
 
+/* laid out to keep devices small, enumerated values are narrowed and
+ * flags are bits */
+struct _ZikPrivate
+{
   ZikConnection *conn;
 
-  /* audio */
-  gboolean noise_control;
-  ZikNoiseControlMode noise_control_mode;
-  guint noise_control_strength;
-  gchar *source;
-  guint volume;
-  gboolean sound_effect;
-  ZikSoundEffectRoom sound_effect_room;
-  ZikSoundEffectAngle sound_effect_angle;
+  /* GQueue of ZikPrefetch per ZikApiPathId, for answers requested ahead,
+   * created on first prefetch */
+  GQueue **prefetches;
+
   ZikMetadataInfo *track_metadata;
-  gboolean equalizer;
-  gboolean smart_audio_tune;
 
-  /* software */
-  gchar *software_version;
-  gboolean tts;
+  /* interned, see zik_attr_intern () */
+  const gchar *source;
+  const gchar *battery_state;
+
+  /* ZikString => offset in strings */
+  gchar *strings;
+  guint16 string_offsets[ZIK_N_STRINGS];
+
+  /* audio */
+  guint16 volume;
+  guint8 noise_control_mode;
+  guint8 noise_control_strength;
+  guint8 sound_effect_room;
+  guint8 sound_effect_angle;
 
   /* system */
-  gchar *battery_state;
-  guint battery_percentage;
-  gboolean head_detection;
-  gchar *serial;
-  gboolean auto_connection;
-  guint auto_power_off_timeout;
-
-  /* others */
-  gboolean flight_mode;
-  gchar *friendlyname;  /* the name used to generate the real bluetooth name */
+  guint8 battery_percentage;
+  guint16 auto_power_off_timeout;
+
+  guint noise_control : 1;
+  guint sound_effect : 1;
+  guint equalizer : 1;
+  guint smart_audio_tune : 1;
+  guint tts : 1;
+  guint head_detection : 1;
+  guint auto_connection : 1;
+  guint flight_mode : 1;
+};
+
+/* time in us a prefetched answer is used for, after that it may no longer
+ * reflect device state and request is sent again */
+#define ZIK_PREFETCH_MAX_AGE (2 * G_TIME_SPAN_SECOND)
+
+/* a get request sent ahead, shared between zik and the request callback */
+typedef struct
+{
+  gint ref_count;
+  gboolean done;
+  /* monotonic time answer was received at */
+  gint64 received;
+  ZikMessage *answer;
+} ZikPrefetch;
+
+/* Static properties get requests, sent all at once to pipeline them */
+static const gchar *static_properties_paths[] = {
+  ZIK_API_AUDIO_NOISE_CONTROL_ENABLED_PATH,
+  ZIK_API_AUDIO_NOISE_CONTROL_PATH,
+  ZIK_API_AUDIO_SOUND_EFFECT_PATH,
+  ZIK_API_AUDIO_EQUALIZER_ENABLED_PATH,
+  ZIK_API_AUDIO_SMART_AUDIO_TUNE_PATH,
+  ZIK_API_SOFTWARE_VERSION_PATH,
+  ZIK_API_SYSTEM_PI_PATH,
+  ZIK_API_SYSTEM_HEAD_DETECTION_ENABLED_PATH,
+  ZIK_API_FLIGHT_MODE_PATH,
+  ZIK_API_BLUETOOTH_FRIENDLY_NAME_PATH,
+  ZIK_API_SYSTEM_AUTO_CONNECTION_ENABLED_PATH,
+  ZIK_API_SYSTEM_AUTO_POWER_OFF_PATH,
+  ZIK_API_SOFTWARE_TTS_PATH,
+  NULL
 };
 
 #define ZIK_NOISE_CONTROL_MODE_TYPE (zik_noise_control_mode_get_type ())
@@ -139,34 +191,6 @@ zik_sound_effect_room_get_type (void)
   return type;
 }
 
-ZikSoundEffectRoom
-zik_sound_effect_room_from_string (const gchar * str)
-{
-  GEnumClass *klass;
-  GEnumValue *value;
-
-  klass = G_ENUM_CLASS (g_type_class_peek (ZIK_SOUND_EFFECT_ROOM_TYPE));
-  value = g_enum_get_value_by_nick (klass, str);
-  if (value == NULL)
-    return ZIK_SOUND_EFFECT_ROOM_UNKNOWN;
-
-  return value->value;
-}
-
-const gchar *
-zik_sound_effect_room_name (ZikSoundEffectRoom room)
-{
-  GEnumClass *klass;
-  GEnumValue *value;
-
-  klass = G_ENUM_CLASS (g_type_class_peek (ZIK_SOUND_EFFECT_ROOM_TYPE));
-  value = g_enum_get_value (klass, room);
-  if (value == NULL)
-    return "unknown";
-
-  return value->value_nick;
-}
-
 #define ZIK_SOUND_EFFECT_ANGLE_TYPE (zik_sound_effect_angle_get_type ())
 static GType
 zik_sound_effect_angle_get_type (void)
@@ -191,11 +215,59 @@ zik_sound_effect_angle_get_type (void)
   return type;
 }
 
-static inline void
-_string_replace (gchar ** old, const gchar * new)
+static inline const gchar *
+zik_peek_string (Zik * zik, ZikString id)
 {
-  g_free (*old);
-  *old = g_strdup (new);
+  ZikPrivate *priv = zik->priv;
+
+  if (priv->string_offsets[id] == ZIK_STRING_NONE)
+    return NULL;
+
+  return priv->strings + priv->string_offsets[id];
+}
+
+/* repack strings of @zik with @value for @id, which is kept if equal so that
+ * polling does not reallocate */
+static void
+zik_update_string (Zik * zik, ZikString id, const gchar * value)
+{
+  ZikPrivate *priv = zik->priv;
+  const gchar *values[ZIK_N_STRINGS];
+  gsize lengths[ZIK_N_STRINGS];
+  gsize size = 0;
+  gchar *strings;
+  guint i;
+
+  if (g_strcmp0 (zik_peek_string (zik, id), value) == 0)
+    return;
+
+  for (i = 0; i < ZIK_N_STRINGS; i++) {
+    values[i] = (i == id) ? value : zik_peek_string (zik, i);
+    lengths[i] = values[i] ? strlen (values[i]) + 1 : 0;
+    size += lengths[i];
+  }
+
+  if (size >= ZIK_STRING_NONE) {
+    g_warning ("strings of device are too long, ignoring '%s'", value);
+    return;
+  }
+
+  strings = g_malloc (size);
+  size = 0;
+  for (i = 0; i < ZIK_N_STRINGS; i++) {
+    if (values[i] == NULL) {
+      priv->string_offsets[i] = ZIK_STRING_NONE;
+      continue;
+    }
+
+    memcpy (strings + size, values[i], lengths[i]);
+    priv->string_offsets[i] = size;
+    size += lengths[i];
+  }
+
+  /* values may point in old strings */
+  g_free (priv->strings);
+  priv->strings = strings;
 }
 
 #define parent_class zik_parent_class
@@ -347,16 +419,36 @@ zik_class_init (ZikClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
+static void
+zik_prefetch_unref (ZikPrefetch * prefetch)
+{
+  if (g_atomic_int_dec_and_test (&prefetch->ref_count)) {
+    if (prefetch->answer)
+      zik_message_free (prefetch->answer);
+
+    g_slice_free (ZikPrefetch, prefetch);
+  }
+}
+
+static void
+zik_prefetch_queue_free (GQueue * queue)
+{
+  g_queue_free_full (queue, (GDestroyNotify) zik_prefetch_unref);
+}
+
 static void
 zik_init (Zik * zik)
 {
+  guint i;
+
   zik->priv = G_TYPE_INSTANCE_GET_PRIVATE (zik, ZIK_TYPE, ZikPrivate);
 
-  zik->priv->serial = g_strdup (UNKNOWN_STR);
-  zik->priv->software_version = g_strdup (UNKNOWN_STR);
-  zik->priv->source = g_strdup (UNKNOWN_STR);
-  zik->priv->battery_state = g_strdup (UNKNOWN_STR);
-  zik->priv->friendlyname = g_strdup (UNKNOWN_STR);
+  for (i = 0; i < ZIK_N_STRINGS; i++)
+    zik->priv->string_offsets[i] = ZIK_STRING_NONE;
+
+  zik_update_string (zik, ZIK_STRING_SOFTWARE_VERSION, UNKNOWN_STR);
+  zik_update_string (zik, ZIK_STRING_SERIAL, UNKNOWN_STR);
+  zik_update_string (zik, ZIK_STRING_FRIENDLYNAME, UNKNOWN_STR);
 
   zik->priv->noise_control_strength = DEFAULT_NOISE_CONTROL_STRENGTH;
 }
@@ -367,13 +459,7 @@ zik_finalize (GObject * object)
   Zik *zik = ZIK (object);
   ZikPrivate *priv = zik->priv;
 
-  g_free (priv->name);
-  g_free (priv->address);
-  g_free (priv->serial);
-  g_free (priv->software_version);
-  g_free (priv->source);
-  g_free (priv->battery_state);
-  g_free (priv->friendlyname);
+  g_free (priv->strings);
 
   if (priv->track_metadata)
     zik_metadata_info_unref (priv->track_metadata);
@@ -381,28 +467,162 @@ zik_finalize (GObject * object)
   if (priv->conn)
     zik_connection_unref (priv->conn);
 
+  if (priv->prefetches) {
+    guint i;
+
+    for (i = 0; i < ZIK_N_API_PATHS; i++) {
+      if (priv->prefetches[i])
+        zik_prefetch_queue_free (priv->prefetches[i]);
+    }
+    g_free (priv->prefetches);
+  }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+zik_prefetch_done_cb (GObject * source, GAsyncResult * res, gpointer userdata)
+{
+  ZikPrefetch *prefetch = (ZikPrefetch *) userdata;
+  GError *error = NULL;
+
+  prefetch->answer = zik_connection_send_message_finish (NULL, res, &error);
+  if (prefetch->answer == NULL) {
+    g_warning ("prefetch request failed: %s", error->message);
+    g_error_free (error);
+  }
+
+  prefetch->received = g_get_monotonic_time ();
+  prefetch->done = TRUE;
+  zik_prefetch_unref (prefetch);
+}
+
+/* Send get requests for the NULL-terminated @paths without waiting for
+ * answers so that they are pipelined on the connection. Answers are consumed
+ * by the next zik_do_request() get on the same path */
+void
+zik_prefetch (Zik * zik, const gchar * const * paths)
+{
+  ZikConnection *conn = zik_get_connection (zik);
+  GMainContext *context = zik_connection_get_context (conn);
+  guint i;
+
+  /* answer callbacks are dispatched from the connection context which is
+   * iterated when waiting for them */
+  g_main_context_push_thread_default (context);
+
+  if (zik->priv->prefetches == NULL)
+    zik->priv->prefetches = g_new0 (GQueue *, ZIK_N_API_PATHS);
+
+  for (i = 0; paths[i] != NULL; i++) {
+    ZikPrefetch *prefetch;
+    ZikApiPathId id;
+
+    id = zik_api_path_lookup (paths[i], strlen (paths[i]));
+    if (id == ZIK_API_PATH_UNKNOWN) {
+      g_warning ("cannot prefetch unknown path '%s'", paths[i]);
+      continue;
+    }
+
+    prefetch = g_slice_new0 (ZikPrefetch);
+    prefetch->ref_count = 2;
+
+    if (zik->priv->prefetches[id] == NULL)
+      zik->priv->prefetches[id] = g_queue_new ();
+    g_queue_push_tail (zik->priv->prefetches[id], prefetch);
+
+    zik_connection_send_message_async (conn,
+        zik_message_new_request (paths[i], "get", NULL), NULL,
+        zik_prefetch_done_cb, prefetch);
+  }
+
+  g_main_context_pop_thread_default (context);
+}
+
+/* wait for answer of a prefetched get request if any, return FALSE if there
+ * is none or if it is too old to be used */
+static gboolean
+zik_take_prefetched_answer (Zik * zik, const gchar * path,
+    ZikMessage ** answer)
+{
+  GMainContext *context = zik_connection_get_context (zik->priv->conn);
+  ZikPrefetch *prefetch;
+  ZikApiPathId id;
+
+  if (zik->priv->prefetches == NULL)
+    return FALSE;
+
+  id = zik_api_path_lookup (path, strlen (path));
+  if (id == ZIK_API_PATH_UNKNOWN || zik->priv->prefetches[id] == NULL)
+    return FALSE;
+
+  prefetch = g_queue_pop_head (zik->priv->prefetches[id]);
+  if (prefetch == NULL)
+    return FALSE;
+
+  while (!prefetch->done)
+    g_main_context_iteration (context, TRUE);
+
+  if (g_get_monotonic_time () - prefetch->received > ZIK_PREFETCH_MAX_AGE) {
+    zik_prefetch_unref (prefetch);
+    return FALSE;
+  }
+
+  *answer = prefetch->answer;
+  prefetch->answer = NULL;
+  zik_prefetch_unref (prefetch);
+
+  return TRUE;
+}
+
+/* send request or take its prefetched answer, @parser being fed with the
+ * answer as it is received */
+static gboolean
+zik_send_request (Zik * zik, const gchar * path, const gchar * method,
+    const gchar * args, ZikReplyParser * parser, ZikMessage ** reply)
+{
+  ZikMessage *msg;
+  gboolean ret = FALSE;
+
+  msg = zik_message_new_request (path, method, args);
+
+  if (args == NULL && g_strcmp0 (method, "get") == 0 &&
+      zik_take_prefetched_answer (zik, path, reply)) {
+    if (*reply == NULL) {
+      g_critical ("failed to send request '%s/%s'", path, method);
+      goto out;
+    }
+  } else if (!zik_connection_send_message_with_parser (
+          zik_get_connection (zik), msg, parser, reply)) {
+    g_critical ("failed to send request '%s/%s with args %s'", path, method,
+        args);
+    goto out;
+  }
+
+  ret = TRUE;
+
+out:
+  zik_message_free (msg);
+
+  return ret;
+}
+
 /* reply: allow-none */
 gboolean
 zik_do_request (Zik * zik, const gchar * path, const gchar * method,
     const gchar * args, ZikRequestReplyData ** reply_data)
 {
-  ZikMessage *msg;
+  ZikReplyParser *parser;
   ZikMessage *reply = NULL;
   ZikRequestReplyData *result;
   gboolean ret = FALSE;
 
-  msg = zik_message_new_request (path, method, args);
+  parser = zik_reply_parser_new (G_TYPE_NONE);
 
-  if (!zik_connection_send_message (zik_get_connection (zik), msg, &reply)) {
-    g_critical ("failed to send request '%s/%s with args %s'", path, method,
-        args);
+  if (!zik_send_request (zik, path, method, args, parser, &reply))
     goto out;
-  }
 
-  if (!zik_message_parse_request_reply (reply, &result)) {
+  if (!zik_reply_parser_finish_reply (parser, reply, &result)) {
     g_critical ("failed to parse request reply '%s/%s with args %s'", path,
         method, args);
     goto out;
@@ -423,7 +643,7 @@ zik_do_request (Zik * zik, const gchar * path, const gchar * method,
   ret = TRUE;
 
 out:
-  zik_message_free (msg);
+  zik_reply_parser_free (parser);
 
   if (reply)
     zik_message_free (reply);
@@ -435,21 +655,34 @@ out:
 gpointer
 zik_request_info (Zik * zik, const gchar * path, GType type)
 {
-  ZikRequestReplyData *reply = NULL;
-  gpointer info;
+  ZikReplyParser *parser;
+  ZikMessage *reply = NULL;
+  gpointer info = NULL;
+  gboolean error;
 
-  if (!zik_do_request (zik, path, "get", NULL, &reply))
-    return NULL;
+  /* only build the wanted info, no tree nor copy */
+  parser = zik_reply_parser_new (type);
 
-  info = zik_request_reply_data_find_node_info (reply, type);
-  if (info == NULL)
+  if (!zik_send_request (zik, path, "get", NULL, parser, &reply))
     goto out;
 
-  /* make a copy to free reply */
-  info = g_boxed_copy (type, info);
+  if (!zik_reply_parser_finish_info (parser, reply, &info, &error)) {
+    g_critical ("failed to parse request reply '%s/get'", path);
+    goto out;
+  }
+
+  if (error) {
+    g_warning ("device reply with error '%s/get'", path);
+    if (info)
+      g_boxed_free (type, info);
+    info = NULL;
+  }
 
 out:
-  zik_request_reply_data_free (reply);
+  zik_reply_parser_free (parser);
+
+  if (reply)
+    zik_message_free (reply);
 
   return info;
 }
@@ -466,7 +699,7 @@ zik_sync_serial (Zik * zik)
     return;
   }
 
-  _string_replace (&zik->priv->serial, info->pi);
+  zik_update_string (zik, ZIK_STRING_SERIAL, info->pi);
   zik_system_info_unref (info);
 }
 
@@ -490,8 +723,6 @@ static void
 zik_sync_noise_control_mode_and_strength (Zik * zik)
 {
   ZikNoiseControlInfo *info;
-  GEnumClass *klass;
-  GEnumValue *mode;
 
   info = zik_request_info (zik, ZIK_API_AUDIO_NOISE_CONTROL_PATH,
       ZIK_NOISE_CONTROL_INFO_TYPE);
@@ -500,16 +731,13 @@ zik_sync_noise_control_mode_and_strength (Zik * zik)
     return;
   }
 
-  klass = G_ENUM_CLASS (g_type_class_peek (ZIK_NOISE_CONTROL_MODE_TYPE));
-  mode = g_enum_get_value_by_nick (klass, info->type);
-  if (mode == NULL) {
-    g_warning ("failed to get enum value associated with '%s'", info->type);
-    goto out;
-  }
-  zik->priv->noise_control_mode = mode->value;
-  zik->priv->noise_control_strength = info->value;
+  /* keep previous mode when device reports one we don't know */
+  if (info->type == ZIK_NOISE_CONTROL_MODE_UNKNOWN)
+    g_warning ("unknown noise control mode");
+  else
+    zik->priv->noise_control_mode = info->type;
 
-out:
+  zik->priv->noise_control_strength = info->value;
   zik_noise_control_info_unref (info);
 }
 
@@ -521,19 +749,10 @@ zik_set_noise_control_mode_and_strength (Zik * zik,
   const gchar *type;
   gchar *args;
 
-  switch (mode) {
-    case ZIK_NOISE_CONTROL_MODE_OFF:
-      type = "off";
-      break;
-    case ZIK_NOISE_CONTROL_MODE_ANC:
-      type = "anc";
-      break;
-    case ZIK_NOISE_CONTROL_MODE_AOC:
-      type = "aoc";
-      break;
-    default:
-      g_assert_not_reached ();
-  }
+  g_return_val_if_fail (mode != ZIK_NOISE_CONTROL_MODE_UNKNOWN, FALSE);
+
+  type = zik_noise_control_mode_to_string (mode);
+  g_return_val_if_fail (type != NULL, FALSE);
 
   args = g_strdup_printf ("%s&value=%u", type, strength);
   ret = zik_do_request (zik, ZIK_API_AUDIO_NOISE_CONTROL_PATH, "set", args,
@@ -555,7 +774,7 @@ zik_sync_software_version (Zik * zik)
     return;
   }
 
-  _string_replace (&zik->priv->software_version, info->sip6);
+  zik_update_string (zik, ZIK_STRING_SOFTWARE_VERSION, info->sip6);
   zik_software_info_unref (info);
 }
 
@@ -571,7 +790,7 @@ zik_sync_source (Zik * zik)
     return;
   }
 
-  _string_replace (&zik->priv->source, info->type);
+  zik->priv->source = info->type;
   zik_source_info_unref (info);
 }
 
@@ -587,7 +806,7 @@ zik_sync_battery (Zik * zik)
     return;
   }
 
-  _string_replace (&zik->priv->battery_state, info->state);
+  zik->priv->battery_state = info->state;
   zik->priv->battery_percentage = info->percent;
   zik_battery_info_unref (info);
 }
@@ -652,7 +871,7 @@ zik_sync_friendlyname (Zik * zik)
     return;
   }
 
-  _string_replace (&zik->priv->friendlyname, info->friendlyname);
+  zik_update_string (zik, ZIK_STRING_FRIENDLYNAME, info->friendlyname);
   zik_bluetooth_info_unref (info);
 }
 
@@ -669,8 +888,7 @@ zik_sync_sound_effect (Zik * zik)
   }
 
   zik->priv->sound_effect = info->enabled;
-  zik->priv->sound_effect_room =
-      zik_sound_effect_room_from_string (info->room_size);
+  zik->priv->sound_effect_room = info->room_size;
   zik->priv->sound_effect_angle = info->angle;
   zik_sound_effect_info_unref (info);
 }
@@ -884,10 +1102,11 @@ zik_set_property (GObject * object, guint prop_id, const GValue * value,
 
   switch (prop_id) {
     case PROP_NAME:
-      priv->name = g_value_dup_string (value);
+      zik_update_string (zik, ZIK_STRING_NAME, g_value_get_string (value));
       break;
     case PROP_ADDRESS:
-      priv->address = g_value_dup_string (value);
+      zik_update_string (zik, ZIK_STRING_ADDRESS,
+          g_value_get_string (value));
       break;
     case PROP_CONNECTION:
       priv->conn = g_value_get_boxed (value);
@@ -974,6 +1193,8 @@ zik_set_property (GObject * object, guint prop_id, const GValue * value,
 void
 zik_sync_static_properties (Zik * zik)
 {
+  zik_prefetch (zik, static_properties_paths);
+
   /* audio */
   zik_sync_noise_control (zik);
   zik_sync_noise_control_mode_and_strength (zik);
@@ -995,13 +1216,13 @@ zik_sync_static_properties (Zik * zik)
 const gchar *
 zik_get_name (Zik * zik)
 {
-  return zik->priv->name;
+  return zik_peek_string (zik, ZIK_STRING_NAME);
 }
 
 const gchar *
 zik_get_address (Zik * zik)
 {
-  return zik->priv->address;
+  return zik_peek_string (zik, ZIK_STRING_ADDRESS);
 }
 
 /* transfer none */
@@ -1028,7 +1249,7 @@ zik_set_noise_control_active (Zik * zik, gboolean active)
     /* resync all noise controls mode and strength because their are modified
      * by set_active call */
     zik_sync_noise_control_mode_and_strength (zik);
-    zik->priv->noise_control = active;
+    zik->priv->noise_control = active != FALSE;
   }
 
   return ret;
@@ -1085,8 +1306,12 @@ zik_set_noise_control_strength (Zik * zik, guint strength)
 const gchar *
 zik_get_source (Zik * zik)
 {
+  const gchar *value;
+
   zik_sync_source (zik);
-  return zik->priv->source;
+  value = zik->priv->source;
+
+  return value ? value : UNKNOWN_STR;
 }
 
 guint
@@ -1110,7 +1335,7 @@ zik_set_sound_effect_active (Zik * zik, gboolean active)
   ret = zik_do_request (zik, ZIK_API_AUDIO_SOUND_EFFECT_ENABLED_PATH, "set",
       active ? "true" : "false", NULL);
   if (ret)
-    zik->priv->sound_effect = active;
+    zik->priv->sound_effect = active != FALSE;
 
   return ret;
 }
@@ -1127,7 +1352,7 @@ zik_set_sound_effect_room (Zik * zik, ZikSoundEffectRoom room)
   gboolean ret;
 
   ret = zik_do_request (zik, ZIK_API_AUDIO_SOUND_EFFECT_ROOM_SIZE_PATH,
-      "set", zik_sound_effect_room_name (room), NULL);
+      "set", zik_sound_effect_room_to_string (room), NULL);
   if (ret) {
     zik_sync_sound_effect (zik);
     zik->priv->sound_effect_room = room;
@@ -1145,10 +1370,12 @@ zik_get_sound_effect_angle (Zik * zik)
 gboolean
 zik_set_sound_effect_angle (Zik * zik, ZikSoundEffectAngle angle)
 {
+  const gchar *args;
   gboolean ret;
-  gchar *args;
 
-  args = g_strdup_printf ("%u", angle);
+  args = zik_sound_effect_angle_to_string (angle);
+  g_return_val_if_fail (args != NULL, FALSE);
+
   ret = zik_do_request (zik, ZIK_API_AUDIO_SOUND_EFFECT_ANGLE_PATH, "set",
       args, NULL);
   if (ret) {
@@ -1156,21 +1383,24 @@ zik_set_sound_effect_angle (Zik * zik, ZikSoundEffectAngle angle)
     zik->priv->sound_effect_angle = angle;
   }
 
-  g_free (args);
   return ret;
 }
 
 const gchar *
 zik_get_software_version (Zik * zik)
 {
-  return zik->priv->software_version;
+  return zik_peek_string (zik, ZIK_STRING_SOFTWARE_VERSION);
 }
 
 const gchar *
 zik_get_battery_state (Zik * zik)
 {
+  const gchar *value;
+
   zik_sync_battery (zik);
-  return zik->priv->battery_state;
+  value = zik->priv->battery_state;
+
+  return value ? value : UNKNOWN_STR;
 }
 
 guint
@@ -1194,7 +1424,7 @@ zik_set_head_detection_active (Zik * zik, gboolean active)
   ret = zik_do_request (zik, ZIK_API_SYSTEM_HEAD_DETECTION_ENABLED_PATH,
       "set", active ? "true" : "false", NULL);
   if (ret)
-    zik->priv->head_detection = active;
+    zik->priv->head_detection = active != FALSE;
 
   return ret;
 }
@@ -1202,7 +1432,7 @@ zik_set_head_detection_active (Zik * zik, gboolean active)
 const gchar *
 zik_get_serial (Zik * zik)
 {
-  return zik->priv->serial;
+  return zik_peek_string (zik, ZIK_STRING_SERIAL);
 }
 
 gboolean
@@ -1224,7 +1454,7 @@ zik_set_flight_mode_active (Zik * zik, gboolean active)
 
   ret = zik_do_request (zik, ZIK_API_FLIGHT_MODE_PATH, method, NULL, NULL);
   if (ret)
-    zik->priv->flight_mode = active;
+    zik->priv->flight_mode = active != FALSE;
 
   return ret;
 }
@@ -1232,7 +1462,7 @@ zik_set_flight_mode_active (Zik * zik, gboolean active)
 const gchar *
 zik_get_friendlyname (Zik * zik)
 {
-  return zik->priv->friendlyname;
+  return zik_peek_string (zik, ZIK_STRING_FRIENDLYNAME);
 }
 
 gboolean
@@ -1243,7 +1473,7 @@ zik_set_friendlyname (Zik * zik, const gchar * name)
   ret = zik_do_request (zik, ZIK_API_BLUETOOTH_FRIENDLY_NAME_PATH, "set",
       name, NULL);
   if (ret)
-    _string_replace (&zik->priv->friendlyname, name);
+    zik_update_string (zik, ZIK_STRING_FRIENDLYNAME, name);
 
   return ret;
 }
@@ -1262,7 +1492,7 @@ zik_set_auto_connection_active (Zik * zik, gboolean active)
   ret = zik_do_request (zik, ZIK_API_SYSTEM_AUTO_CONNECTION_ENABLED_PATH,
       "set", active ? "true" : "false", NULL);
   if (ret)
-    zik->priv->auto_connection = active;
+    zik->priv->auto_connection = active != FALSE;
 
   return ret;
 }
@@ -1308,7 +1538,7 @@ zik_set_equalizer_active (Zik * zik, gboolean active)
   ret = zik_do_request (zik, ZIK_API_AUDIO_EQUALIZER_ENABLED_PATH, "set",
       active ? "true" : "false", NULL);
   if (ret)
-    zik->priv->equalizer = active;
+    zik->priv->equalizer = active != FALSE;
 
   return ret;
 }
@@ -1327,7 +1557,7 @@ zik_set_smart_audio_tune_active (Zik * zik, gboolean active)
   ret = zik_do_request (zik, ZIK_API_AUDIO_SMART_AUDIO_TUNE_PATH, "set",
       active ? "true" : "false", NULL);
   if (ret)
-    zik->priv->smart_audio_tune = active;
+    zik->priv->smart_audio_tune = active != FALSE;
 
   return ret;
 }
@@ -1373,7 +1603,7 @@ zik_set_tts_active (Zik * zik, gboolean active)
 
   ret = zik_do_request (zik, ZIK_API_SOFTWARE_TTS_PATH, method, NULL, NULL);
   if (ret)
-    zik->priv->tts = active;
+    zik->priv->tts = active != FALSE;
 
   return ret;
 }
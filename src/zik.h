@@ -21,6 +21,8 @@
 #include <glib.h>
 #include <glib-object.h>
 #include "zikconnection.h"
+/* protocol enumerations, see zikschema.def */
+#include "zikschema.h"
 
 G_BEGIN_DECLS
 
@@ -32,41 +34,10 @@ G_BEGIN_DECLS
 #define IS_ZIK_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), ZIK_TYPE))
 #define ZIK_CAST(obj) ((Zik *) (obj))
 
-typedef enum _ZikNoiseControlMode ZikNoiseControlMode;
-typedef enum _ZikSoundEffectRoom ZikSoundEffectRoom;
-typedef enum _ZikSoundEffectAngle ZikSoundEffectAngle;
-
 typedef struct _ZikClass ZikClass;
 typedef struct _Zik Zik;
 typedef struct _ZikPrivate ZikPrivate;
 
-enum _ZikNoiseControlMode
-{
-  ZIK_NOISE_CONTROL_MODE_OFF,
-  ZIK_NOISE_CONTROL_MODE_ANC,
-  ZIK_NOISE_CONTROL_MODE_AOC
-};
-
-enum _ZikSoundEffectRoom
-{
-  ZIK_SOUND_EFFECT_ROOM_UNKNOWN,
-  ZIK_SOUND_EFFECT_ROOM_SILENT,
-  ZIK_SOUND_EFFECT_ROOM_LIVING,
-  ZIK_SOUND_EFFECT_ROOM_JAZZ,
-  ZIK_SOUND_EFFECT_ROOM_CONCERT
-};
-
-enum _ZikSoundEffectAngle
-{
-  ZIK_SOUND_EFFECT_ANGLE_UNKNOWN = 0,
-  ZIK_SOUND_EFFECT_ANGLE_30 = 30,
-  ZIK_SOUND_EFFECT_ANGLE_60 = 60,
-  ZIK_SOUND_EFFECT_ANGLE_90 = 90,
-  ZIK_SOUND_EFFECT_ANGLE_120 = 120,
-  ZIK_SOUND_EFFECT_ANGLE_150 = 150,
-  ZIK_SOUND_EFFECT_ANGLE_180 = 180
-};
-
 struct _Zik
 {
   GObject parent;
@@ -79,9 +50,6 @@ struct _ZikClass
   GObjectClass parent_class;
 };
 
-ZikSoundEffectRoom zik_sound_effect_room_from_string (const gchar * str);
-const gchar *zik_sound_effect_room_name (ZikSoundEffectRoom room);
-
 GType zik_get_type (void);
 
 const gchar *zik_get_name (Zik * zik);
@@ -150,6 +118,7 @@ gboolean zik_set_tts_active (Zik * zik, gboolean active);
 gboolean zik_do_request (Zik * zik, const gchar * path, const gchar * method,
     const gchar * args, ZikRequestReplyData ** reply_data);
 gpointer zik_request_info (Zik * zik, const gchar * path, GType type);
+void zik_prefetch (Zik * zik, const gchar * const * paths);
 void zik_sync_static_properties (Zik * zik);
 
 G_END_DECLS
@@ -35,7 +35,8 @@ enum
 
 struct _Zik2Private
 {
-  Zik2Color color;
+  /* Zik2Color */
+  guint8 color;
 };
 
 #define ZIK2_COLOR_TYPE (zik2_color_get_type ())
@@ -85,6 +86,11 @@ zik2_init (Zik2 * zik2)
   zik2->priv = G_TYPE_INSTANCE_GET_PRIVATE (zik2, ZIK2_TYPE, Zik2Private);
 }
 
+static const gchar *zik2_static_properties_paths[] = {
+  ZIK_API_SYSTEM_COLOR_PATH,
+  NULL
+};
+
 static void
 zik2_sync_color (Zik2 * zik2)
 {
@@ -122,6 +128,7 @@ zik2_get_property (GObject * object, guint prop_id, GValue * value,
 static void
 zik2_sync_static_properties (Zik2 * zik2)
 {
+  zik_prefetch (ZIK (zik2), zik2_static_properties_paths);
   zik_sync_static_properties (ZIK (zik2));
 
   zik2_sync_color (zik2);
@@ -33,19 +33,10 @@ G_BEGIN_DECLS
 #define IS_ZIK2_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), ZIK2_TYPE))
 #define ZIK2_CAST(obj) ((Zik2 *) (obj))
 
-typedef enum _Zik2Color Zik2Color;
-
 typedef struct _Zik2Class Zik2Class;
 typedef struct _Zik2 Zik2;
 typedef struct _Zik2Private Zik2Private;
 
-enum _Zik2Color
-{
-  ZIK2_COLOR_UNKNOWN = 0x0,
-  ZIK2_COLOR_BLACK = 0x1,
-  ZIK2_COLOR_BLUE = 0x2,
-};
-
 struct _Zik2
 {
   Zik parent;
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <glib.h>
 #include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -58,6 +59,13 @@ static gchar *auto_noise_control_switch = NULL;
 static gchar *request_path = NULL;
 static gchar *request_method = NULL;
 static gchar *request_args = NULL;
+static gboolean lockstep = FALSE;
+static gchar *socket_path = NULL;
+static gchar *socket_model = NULL;
+static gchar *capture_path = NULL;
+static gchar *replay_path = NULL;
+static gboolean replay_timed = FALSE;
+static gboolean strict_xml = FALSE;
 
 static GOptionEntry entries[] = {
   { "list", 'l', 0, G_OPTION_ARG_NONE, &list_devices, "List Zik devices paired", NULL },
@@ -81,45 +89,16 @@ static GOptionEntry entries[] = {
   { "request-path", 0, 0, G_OPTION_ARG_STRING, &request_path, "custom request path (development/debug purpose)", "/api/..." },
   { "request-method", 0, 0, G_OPTION_ARG_STRING, &request_method, "custom method to call (development/debug purpose)", "get" },
   { "request-args", 0, 0, G_OPTION_ARG_STRING, &request_args, "custom args (development/debug purpose)", "true" },
+  { "lockstep", 0, 0, G_OPTION_ARG_NONE, &lockstep, "Wait for each answer before sending next request (for misbehaving firmware)", NULL },
+  { "socket", 0, 0, G_OPTION_ARG_FILENAME, &socket_path, "Connect to an emulated device on UNIX socket, see zik-sim (development/debug purpose)", "PATH" },
+  { "model", 0, 0, G_OPTION_ARG_STRING, &socket_model, "Model of the emulated or replayed device (development/debug purpose)", "<zik2|zik3>" },
+  { "capture", 0, 0, G_OPTION_ARG_FILENAME, &capture_path, "Record traffic with device to a capture file (development/debug purpose)", "FILE" },
+  { "replay", 0, 0, G_OPTION_ARG_FILENAME, &replay_path, "Play device from a capture file instead of connecting (development/debug purpose)", "FILE" },
+  { "replay-timed", 0, 0, G_OPTION_ARG_NONE, &replay_timed, "Keep delays of capture while replaying it", NULL },
+  { "strict-xml", 0, 0, G_OPTION_ARG_NONE, &strict_xml, "Parse answers with GMarkup only (development/debug purpose)", NULL },
   { NULL, 0, 0, 0, NULL, NULL, NULL }
 };
 
-typedef struct _Zik2Api Zik2Api;
-struct _Zik2Api
-{
-  gchar *name;
-  gchar *get_uri;
-};
-
-static const Zik2Api zik2_api[] = {
-  { "ZIK_API_AUDIO_TRACK_METADATA_PATH", ZIK_API_AUDIO_TRACK_METADATA_PATH },
-  { "ZIK_API_AUDIO_NOISE_CONTROL_ENABLED_PATH", ZIK_API_AUDIO_NOISE_CONTROL_ENABLED_PATH },
-  { "ZIK_API_AUDIO_NOISE_CONTROL_PATH", ZIK_API_AUDIO_NOISE_CONTROL_PATH },
-  { "ZIK_API_AUDIO_NOISE_CONTROL_PHONE_MODE_PATH", ZIK_API_AUDIO_NOISE_CONTROL_PHONE_MODE_PATH },
-  { "ZIK_API_AUDIO_THUMB_EQUALIZER_VALUE_PATH", ZIK_API_AUDIO_THUMB_EQUALIZER_VALUE_PATH },
-  { "ZIK_API_AUDIO_EQUALIZER_ENABLED_PATH", ZIK_API_AUDIO_EQUALIZER_ENABLED_PATH },
-  { "ZIK_API_AUDIO_SMART_AUDIO_TUNE_PATH", ZIK_API_AUDIO_SMART_AUDIO_TUNE_PATH },
-  { "ZIK_API_AUDIO_PRESET_BYPASS_PATH", ZIK_API_AUDIO_PRESET_BYPASS_PATH },
-  { "ZIK_API_AUDIO_PRESET_CURRENT_PATH", ZIK_API_AUDIO_PRESET_CURRENT_PATH },
-  { "ZIK_API_AUDIO_SOUND_EFFECT_ENABLED_PATH", ZIK_API_AUDIO_SOUND_EFFECT_ENABLED_PATH },
-  { "ZIK_API_AUDIO_SOUND_EFFECT_PATH", ZIK_API_AUDIO_SOUND_EFFECT_PATH },
-  { "ZIK_API_AUDIO_NOISE_PATH", ZIK_API_AUDIO_NOISE_PATH },
-  { "ZIK_API_AUDIO_VOLUME_PATH", ZIK_API_AUDIO_VOLUME_PATH },
-  { "ZIK_API_AUDIO_SOURCE_PATH", ZIK_API_AUDIO_SOURCE_PATH },
-  { "ZIK_API_SOFTWARE_VERSION_PATH", ZIK_API_SOFTWARE_VERSION_PATH },
-  { "ZIK_API_BLUETOOTH_FRIENDLY_NAME_PATH", ZIK_API_BLUETOOTH_FRIENDLY_NAME_PATH },
-  { "ZIK_API_SYSTEM_BATTERY_PATH", ZIK_API_SYSTEM_BATTERY_PATH },
-  { "ZIK_API_SYSTEM_BATTERY_FORECAST_PATH", ZIK_API_SYSTEM_BATTERY_FORECAST_PATH },
-  { "ZIK_API_SYSTEM_AUTO_CONNECTION_ENABLED_PATH", ZIK_API_SYSTEM_AUTO_CONNECTION_ENABLED_PATH },
-  { "ZIK_API_SYSTEM_ANC_PHONE_MODE_ENABLED_PATH", ZIK_API_SYSTEM_ANC_PHONE_MODE_ENABLED_PATH },
-  { "ZIK_API_SYSTEM_DEVICE_TYPE_PATH", ZIK_API_SYSTEM_DEVICE_TYPE_PATH },
-  { "ZIK_API_SYSTEM_COLOR_PATH", ZIK_API_SYSTEM_COLOR_PATH },
-  { "ZIK_API_SYSTEM_PI_PATH", ZIK_API_SYSTEM_PI_PATH },
-  { "ZIK_API_SYSTEM_HEAD_DETECTION_ENABLED_PATH", ZIK_API_SYSTEM_HEAD_DETECTION_ENABLED_PATH },
-  { "ZIK_API_SYSTEM_FLIGHT_MODE_PATH", ZIK_API_SYSTEM_FLIGHT_MODE_PATH },
-  { NULL, NULL },
-};
-
 static gboolean
 device_has_uuid (BluetoothDevice1 * device, const gchar * req_uuid)
 {
@@ -197,21 +176,30 @@ custom_request (Zik * zik, const gchar * path, const gchar * method,
     const gchar * args)
 {
   ZikMessage *msg;
-  ZikMessage *reply;
-  gchar *xml;
+  ZikMessage *reply = NULL;
+  GError *error = NULL;
+  const gchar *xml;
+  gsize xml_size;
+  gboolean ret;
 
   msg = zik_message_new_request (path, method, args);
-  zik_connection_send_message (zik_get_connection (zik), msg, &reply);
+  ret = zik_connection_send_message_with_error (zik_get_connection (zik), msg,
+      &reply, &error);
   zik_message_free (msg);
 
   g_print ("custom request '%s/%s?arg=%s' reply:\n", path, method, args);
-  xml = zik_message_get_request_reply_xml (reply);
+  if (!ret) {
+    g_print ("request failed: %s\n", error->message);
+    g_error_free (error);
+    return;
+  }
+
+  xml = zik_message_peek_request_reply_xml (reply, &xml_size);
   if (xml)
-    g_print ("%s\n", xml);
+    g_print ("%.*s\n", (gint) xml_size, xml);
   else
     g_print ("no reply...\n");
 
-  g_free (xml);
   zik_message_free (reply);
 
 }
@@ -233,21 +221,6 @@ nc_mode_str (ZikNoiseControlMode mode)
   return "unknown";
 }
 
-static const gchar *
-color_str (Zik2Color color)
-{
-  switch (color) {
-    case ZIK2_COLOR_BLACK:
-      return "black";
-    case ZIK2_COLOR_BLUE:
-      return "blue";
-    default:
-      break;
-  }
-
-  return "unknown";
-}
-
 static void
 show_zik (Zik * zik)
 {
@@ -277,7 +250,7 @@ show_zik (Zik * zik)
   g_print ("  sound effect           : %s\n",
       zik_is_sound_effect_active (zik) ? "on" : "off");
   g_print ("  sound effect room      : %s\n",
-      zik_sound_effect_room_name (zik_get_sound_effect_room (zik)));
+      zik_sound_effect_room_get_name (zik_get_sound_effect_room (zik)));
   g_print ("  sound effect angle     : %u\n",
       zik_get_sound_effect_angle (zik));
 
@@ -308,7 +281,7 @@ show_zik (Zik * zik)
 
   if (IS_ZIK2 (zik))
     g_print ("  color                  : %s\n",
-        color_str (zik2_get_color (ZIK2_CAST (zik))));
+        zik2_color_get_name (zik2_get_color (ZIK2_CAST (zik))));
 
   g_print ("  flight mode            : %s\n",
       zik_is_flight_mode_active (zik) ? "on" : "off");
@@ -407,8 +380,8 @@ set_sound_effect_room (Zik * zik)
 {
   ZikSoundEffectRoom req_mode;
 
-  req_mode = zik_sound_effect_room_from_string (sound_effect_room);
-  if (req_mode == ZIK_SOUND_EFFECT_ROOM_UNKNOWN)
+  if (!zik_sound_effect_room_from_string (sound_effect_room, &req_mode) ||
+      req_mode == ZIK_SOUND_EFFECT_ROOM_UNKNOWN)
     return FALSE;
 
   g_print ("Setting sound effect room to %s\n", sound_effect_room);
@@ -425,6 +398,11 @@ set_sound_effect_angle (Zik * zik)
 {
   guint req_value = sound_effect_angle;
 
+  if (zik_sound_effect_angle_to_string (req_value) == NULL) {
+    g_printerr ("invalid sound effect angle %d\n", sound_effect_angle);
+    return FALSE;
+  }
+
   g_print ("Setting sound_effect_angle to %u\n", sound_effect_angle);
   if (!zik_set_sound_effect_angle (zik, req_value)) {
     g_printerr ("failed to set sound effect angle to %u\n", sound_effect_angle);
@@ -438,6 +416,7 @@ static void
 on_zik_connected (ZikProfile * bprofile, Zik * zik, gpointer userdata)
 {
   gchar *name;
+  guint model;
   guint i;
 
   g_object_get (zik, "name", &name, NULL);
@@ -524,9 +503,14 @@ on_zik_connected (ZikProfile * bprofile, Zik * zik, gpointer userdata)
           flight_mode_switch))
       g_printerr ("Failed to set flight mode\n");
   } else if (dump_api_xml) {
-    for (i = 0; zik2_api[i].name != NULL; i++) {
-      g_print ("- %s\n", zik2_api[i].name);
-      custom_request (zik, zik2_api[i].get_uri, "get", NULL);
+    model = IS_ZIK3 (zik) ? ZIK_MODEL_ZIK3 : ZIK_MODEL_ZIK2;
+
+    for (i = 0; i < ZIK_N_API_PATHS; i++) {
+      if (!zik_api_paths[i].get || !(zik_api_paths[i].models & model))
+        continue;
+
+      g_print ("- %s\n", zik_api_paths[i].name);
+      custom_request (zik, zik_api_paths[i].path, "get", NULL);
     }
   } else if (request_path) {
     custom_request (zik, request_path, request_method, request_args);
@@ -560,6 +544,91 @@ setup_profile (GDBusObjectManager * manager, ZikProfile * profile)
   zik_profile_install (profile, manager);
 }
 
+/* talk to a device without bluez */
+static gboolean
+run_on_transport (ZikTransport * transport)
+{
+  ZikConnection *conn;
+  Zik *zik;
+
+  conn = zik_connection_new_for_transport (transport, NULL);
+
+  if (!zik_connection_open_session (conn)) {
+    g_printerr ("failed to open session\n");
+    zik_connection_unref (conn);
+    return FALSE;
+  }
+
+  if (g_strcmp0 (socket_model, "zik3") == 0)
+    zik = ZIK_CAST (zik3_new ("Parrot ZIK 3", "00:00:00:00:00:00", conn));
+  else
+    zik = ZIK_CAST (zik2_new ("Parrot Zik 2.0", "00:00:00:00:00:00", conn));
+
+  on_zik_connected (NULL, zik, NULL);
+
+  zik_connection_close_session (conn);
+  g_object_unref (zik);
+
+  return TRUE;
+}
+
+/* device emulated by zik-sim */
+static gboolean
+connect_socket (const gchar * path)
+{
+  GSocketAddress *address;
+  GSocket *socket;
+  ZikTransport *transport;
+  gboolean ret;
+  GError *error = NULL;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_DEFAULT, &error);
+  if (socket == NULL) {
+    g_printerr ("failed to create socket: %s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  address = g_unix_socket_address_new (path);
+  if (!g_socket_connect (socket, address, NULL, &error)) {
+    g_printerr ("failed to connect to %s: %s\n", path, error->message);
+    g_error_free (error);
+    g_object_unref (address);
+    g_object_unref (socket);
+    return FALSE;
+  }
+  g_object_unref (address);
+
+  transport = zik_transport_new_for_socket (socket);
+  ret = run_on_transport (transport);
+  zik_transport_unref (transport);
+  g_object_unref (socket);
+
+  return ret;
+}
+
+/* device played from a capture */
+static gboolean
+replay_capture (const gchar * path)
+{
+  ZikTransport *transport;
+  gboolean ret;
+  GError *error = NULL;
+
+  transport = zik_transport_new_for_capture (path, replay_timed, &error);
+  if (transport == NULL) {
+    g_printerr ("failed to load capture: %s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  ret = run_on_transport (transport);
+  zik_transport_unref (transport);
+
+  return ret;
+}
+
 void
 cleanup_profile (ZikProfile * profile, GDBusObjectManager * manager)
 {
@@ -666,6 +735,17 @@ check_arguments (void)
     ret = check_switch_argument (auto_noise_control_switch,
         "set-auto-noise-control");
 
+  if (socket_path && replay_path) {
+    g_printerr ("socket and replay can't be used together\n");
+    ret = FALSE;
+  }
+
+  if (socket_model && g_strcmp0 (socket_model, "zik2") != 0 &&
+      g_strcmp0 (socket_model, "zik3") != 0) {
+    g_printerr ("unrecognized 'model' value\n");
+    ret = FALSE;
+  }
+
   return ret;
 }
 
@@ -679,6 +759,7 @@ main (int argc, char *argv[])
   GDBusObjectManager *manager = NULL;
   gchar *name_owner;
   GSList *zik_devices = NULL;
+  ZikCapture *capture = NULL;
 
   context = g_option_context_new ("- control Zik2/Zik3 settings");
   g_option_context_add_main_entries (context, entries, 0);
@@ -691,6 +772,37 @@ main (int argc, char *argv[])
   if (!check_arguments ())
     goto out;
 
+  if (lockstep)
+    zik_connection_set_default_max_in_flight (1);
+
+  if (strict_xml)
+    zik_message_set_strict_xml (TRUE);
+
+  if (capture_path) {
+    capture = zik_capture_new (capture_path, &error);
+    if (capture == NULL) {
+      g_printerr ("failed to start capture: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+    zik_connection_set_default_capture (capture);
+  }
+
+  if (replay_path) {
+    if (replay_capture (replay_path))
+      ret = EXIT_SUCCESS;
+
+    goto out;
+  }
+
+  if (socket_path) {
+    if (connect_socket (socket_path))
+      ret = EXIT_SUCCESS;
+
+    goto out;
+  }
+
   loop = g_main_loop_new (NULL, FALSE);
 
   /* proxy bluez object manager */
@@ -786,6 +898,11 @@ out:
   if (zik_devices)
     g_slist_free_full (zik_devices, g_object_unref);
 
+  if (capture) {
+    zik_connection_set_default_capture (NULL);
+    zik_capture_unref (capture);
+  }
+
   g_option_context_free (context);
 
   return ret;
@@ -32,8 +32,9 @@ enum
 
 struct _Zik3Private
 {
-  gboolean auto_noise_control;
-  gchar *sound_effect_mode;
+  /* interned, see zik_attr_intern () */
+  const gchar *sound_effect_mode;
+  guint auto_noise_control : 1;
 };
 
 #define parent_class zik3_parent_class
@@ -107,8 +108,7 @@ zik3_sync_sound_effect_mode (Zik3 * zik3)
     return;
   }
 
-  g_free (zik3->priv->sound_effect_mode);
-  zik3->priv->sound_effect_mode = g_strdup (info->mode);
+  zik3->priv->sound_effect_mode = info->mode;
   zik_sound_effect_info_unref (info);
 }
 
@@ -187,7 +187,7 @@ zik3_set_auto_noise_control_active (Zik3 * zik3, gboolean active)
       ZIK_API_AUDIO_NOISE_CONTROL_AUTO_NC_PATH, "set",
       active ? "true" : "false", NULL);
   if (ret)
-    zik3->priv->auto_noise_control = active;
+    zik3->priv->auto_noise_control = active != FALSE;
 
   return ret;
 }
@@ -0,0 +1,510 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "zikcapture.h"
+
+#define ZIK_CAPTURE_FILE_HEADER_LEN 8
+#define ZIK_CAPTURE_RECORD_HEADER_LEN 7
+
+struct _ZikCapture
+{
+  gint ref_count;
+
+  FILE *file;
+  gchar *filename;
+  /* time of previous record */
+  gint64 last;
+  gboolean failed;
+};
+
+/* Start capturing frames to @filename, which is truncated */
+ZikCapture *
+zik_capture_new (const gchar * filename, GError ** error)
+{
+  ZikCapture *capture;
+  guint8 header[ZIK_CAPTURE_FILE_HEADER_LEN] = ZIK_CAPTURE_MAGIC;
+  FILE *file;
+
+  file = g_fopen (filename, "wb");
+  if (file == NULL) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "failed to open %s: %s", filename, g_strerror (errno));
+    return NULL;
+  }
+
+  header[ZIK_CAPTURE_FILE_HEADER_LEN - 1] = ZIK_CAPTURE_VERSION;
+  if (fwrite (header, sizeof (header), 1, file) != 1) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "failed to write %s: %s", filename, g_strerror (errno));
+    fclose (file);
+    return NULL;
+  }
+
+  capture = g_slice_new0 (ZikCapture);
+  capture->ref_count = 1;
+  capture->file = file;
+  capture->filename = g_strdup (filename);
+  capture->last = g_get_monotonic_time ();
+
+  return capture;
+}
+
+ZikCapture *
+zik_capture_ref (ZikCapture * capture)
+{
+  g_atomic_int_inc (&capture->ref_count);
+  return capture;
+}
+
+void
+zik_capture_unref (ZikCapture * capture)
+{
+  if (g_atomic_int_dec_and_test (&capture->ref_count)) {
+    if (fclose (capture->file) != 0)
+      g_warning ("failed to close capture %s: %s", capture->filename,
+          g_strerror (errno));
+
+    g_free (capture->filename);
+    g_slice_free (ZikCapture, capture);
+  }
+}
+
+/* Record a whole message, made of @header then @payload */
+void
+zik_capture_add_frame (ZikCapture * capture, ZikCaptureDirection direction,
+    const guint8 * header, gsize header_size, const guint8 * payload,
+    gsize payload_size)
+{
+  guint8 record[ZIK_CAPTURE_RECORD_HEADER_LEN];
+  gsize size = header_size + payload_size;
+  gint64 now;
+  guint64 delta;
+
+  if (capture->failed)
+    return;
+
+  if (size > G_MAXUINT16) {
+    g_warning ("frame of %" G_GSIZE_FORMAT " bytes can't be captured", size);
+    return;
+  }
+
+  now = g_get_monotonic_time ();
+  delta = MIN ((guint64) (now - capture->last), G_MAXUINT32);
+  capture->last = now;
+
+  record[0] = direction;
+  record[1] = delta >> 24;
+  record[2] = delta >> 16;
+  record[3] = delta >> 8;
+  record[4] = delta;
+  record[5] = size >> 8;
+  record[6] = size;
+
+  if (fwrite (record, sizeof (record), 1, capture->file) != 1 ||
+      (header_size && fwrite (header, header_size, 1, capture->file) != 1) ||
+      (payload_size && fwrite (payload, payload_size, 1, capture->file) != 1)) {
+    /* keep going without capture rather than disturbing connection */
+    g_warning ("failed to write capture %s: %s, stop capturing",
+        capture->filename, g_strerror (errno));
+    capture->failed = TRUE;
+  }
+}
+
+
+/** Replay backend, playing the device side of a capture */
+
+typedef struct
+{
+  ZikCaptureDirection direction;
+  /* us since start of capture */
+  gint64 timestamp;
+  const guint8 *data;
+  gsize size;
+
+  /* index of outgoing record preceding this one, -1 if none */
+  gint prev_out;
+  /* when record has been sent or delivered */
+  gint64 done;
+} ZikReplayRecord;
+
+typedef struct
+{
+  ZikTransport parent;
+
+  gchar *contents;
+  GArray *records;
+  gboolean timed;
+  gint64 start;
+
+  /* next records to be sent and delivered, and bytes of them already
+   * handled */
+  guint out_index;
+  gsize out_offset;
+  guint in_index;
+  gsize in_offset;
+
+  gint64 last_delivery;
+  gboolean diverged;
+} ZikReplayTransport;
+
+typedef struct
+{
+  GSource source;
+
+  ZikReplayTransport *transport;
+  GIOCondition condition;
+} ZikReplaySource;
+
+#define RECORD(self, i) (&g_array_index ((self)->records, ZikReplayRecord, (i)))
+
+static guint
+zik_replay_transport_next (ZikReplayTransport * self, guint index,
+    ZikCaptureDirection direction)
+{
+  while (index < self->records->len &&
+      RECORD (self, index)->direction != direction)
+    index++;
+
+  return index;
+}
+
+/* Return: time from which next incoming record can be delivered, -1 if it
+ * waits for outgoing frames, G_MININT64 if there is nothing more */
+static gint64
+zik_replay_transport_get_release (ZikReplayTransport * self)
+{
+  ZikReplayRecord *rec;
+  ZikReplayRecord *prev;
+  gint64 release;
+
+  if (self->in_index == self->records->len)
+    return self->out_index == self->records->len ? G_MININT64 : -1;
+
+  /* answer comes once everything sent before it in capture has been */
+  rec = RECORD (self, self->in_index);
+  if (rec->prev_out >= (gint) self->out_index)
+    return -1;
+
+  if (!self->timed)
+    return 0;
+
+  /* keep delay of capture between request and answer */
+  if (rec->prev_out >= 0) {
+    prev = RECORD (self, rec->prev_out);
+    release = prev->done + rec->timestamp - prev->timestamp;
+  } else {
+    release = self->start + rec->timestamp;
+  }
+
+  return MAX (release, self->last_delivery);
+}
+
+static gssize
+zik_replay_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error)
+{
+  ZikReplayTransport *self = (ZikReplayTransport *) transport;
+  gssize total = 0;
+  gint i;
+
+  for (i = 0; i < n_vectors; i++) {
+    const guint8 *data = vectors[i].buffer;
+    gsize size = vectors[i].size;
+
+    total += size;
+
+    while (size > 0) {
+      ZikReplayRecord *rec;
+      gsize n;
+
+      if (self->out_index == self->records->len) {
+        if (!self->diverged)
+          g_warning ("ZikReplayTransport %p: more data sent than captured",
+              self);
+        self->diverged = TRUE;
+        break;
+      }
+
+      rec = RECORD (self, self->out_index);
+      n = MIN (size, rec->size - self->out_offset);
+
+      if (!self->diverged && memcmp (rec->data + self->out_offset, data, n)) {
+        g_warning ("ZikReplayTransport %p: sent data diverges from capture "
+            "at record %u", self, self->out_index);
+        self->diverged = TRUE;
+      }
+
+      data += n;
+      size -= n;
+      self->out_offset += n;
+
+      if (self->out_offset == rec->size) {
+        rec->done = g_get_monotonic_time ();
+        self->out_index = zik_replay_transport_next (self,
+            self->out_index + 1, ZIK_CAPTURE_OUTGOING);
+        self->out_offset = 0;
+      }
+    }
+  }
+
+  return total;
+}
+
+static gssize
+zik_replay_transport_receive (ZikTransport * transport, guint8 * buffer,
+    gsize size, GError ** error)
+{
+  ZikReplayTransport *self = (ZikReplayTransport *) transport;
+  ZikReplayRecord *rec;
+  gint64 release;
+  gint64 now;
+  gsize n;
+
+  now = g_get_monotonic_time ();
+  release = zik_replay_transport_get_release (self);
+  if (release == G_MININT64)
+    return 0;
+
+  if (release < 0 || release > now) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK,
+        "no captured data to deliver yet");
+    return -1;
+  }
+
+  rec = RECORD (self, self->in_index);
+  n = MIN (size, rec->size - self->in_offset);
+  memcpy (buffer, rec->data + self->in_offset, n);
+  self->in_offset += n;
+
+  if (self->in_offset == rec->size) {
+    rec->done = now;
+    self->last_delivery = now;
+    self->in_index = zik_replay_transport_next (self, self->in_index + 1,
+        ZIK_CAPTURE_INCOMING);
+    self->in_offset = 0;
+  }
+
+  return n;
+}
+
+static gboolean
+zik_replay_source_prepare (GSource * source, gint * timeout)
+{
+  ZikReplaySource *rsource = (ZikReplaySource *) source;
+  gint64 release;
+  gint64 now;
+
+  /* sending never blocks */
+  if (rsource->condition & G_IO_OUT) {
+    *timeout = 0;
+    return TRUE;
+  }
+
+  release = zik_replay_transport_get_release (rsource->transport);
+  if (release == -1) {
+    *timeout = -1;
+    return FALSE;
+  }
+
+  now = g_source_get_time (source);
+  if (release <= now) {
+    *timeout = 0;
+    return TRUE;
+  }
+
+  *timeout = (release - now + 999) / 1000;
+  return FALSE;
+}
+
+static gboolean
+zik_replay_source_check (GSource * source)
+{
+  gint timeout;
+
+  return zik_replay_source_prepare (source, &timeout);
+}
+
+static gboolean
+zik_replay_source_dispatch (GSource * source, GSourceFunc callback,
+    gpointer userdata)
+{
+  ZikReplaySource *rsource = (ZikReplaySource *) source;
+  ZikTransportWatchFunc func = (ZikTransportWatchFunc) (GCallback) callback;
+
+  if (func == NULL)
+    return G_SOURCE_REMOVE;
+
+  return func ((ZikTransport *) rsource->transport,
+      rsource->condition & G_IO_OUT ? G_IO_OUT : G_IO_IN, userdata);
+}
+
+static void
+zik_replay_source_finalize (GSource * source)
+{
+  ZikReplaySource *rsource = (ZikReplaySource *) source;
+
+  zik_transport_unref ((ZikTransport *) rsource->transport);
+}
+
+static GSourceFuncs zik_replay_source_funcs = {
+  zik_replay_source_prepare,
+  zik_replay_source_check,
+  zik_replay_source_dispatch,
+  zik_replay_source_finalize,
+  NULL, NULL
+};
+
+static GSource *
+zik_replay_transport_create_watch (ZikTransport * transport,
+    GIOCondition condition, ZikTransportWatchFunc func, gpointer userdata,
+    GDestroyNotify notify)
+{
+  ZikReplaySource *rsource;
+  GSource *source;
+
+  source = g_source_new (&zik_replay_source_funcs, sizeof (ZikReplaySource));
+  rsource = (ZikReplaySource *) source;
+  rsource->transport = (ZikReplayTransport *) zik_transport_ref (transport);
+  rsource->condition = condition;
+  g_source_set_callback (source, (GSourceFunc) (GCallback) func, userdata,
+      notify);
+
+  return source;
+}
+
+static void
+zik_replay_transport_finalize (ZikTransport * transport)
+{
+  ZikReplayTransport *self = (ZikReplayTransport *) transport;
+
+  g_array_unref (self->records);
+  g_free (self->contents);
+}
+
+static const ZikTransportFuncs zik_replay_transport_funcs = {
+  .send = zik_replay_transport_send,
+  .receive = zik_replay_transport_receive,
+  .create_watch = zik_replay_transport_create_watch,
+  .finalize = zik_replay_transport_finalize
+};
+
+static gboolean
+zik_replay_transport_parse (ZikReplayTransport * self, const gchar * filename,
+    gsize length, GError ** error)
+{
+  const guint8 *data = (const guint8 *) self->contents;
+  const guint8 *end = data + length;
+  gint64 timestamp = 0;
+  gint prev_out = -1;
+
+  if (length < ZIK_CAPTURE_FILE_HEADER_LEN ||
+      memcmp (data, ZIK_CAPTURE_MAGIC, sizeof (ZIK_CAPTURE_MAGIC)) != 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        "%s is not a capture file", filename);
+    return FALSE;
+  }
+
+  if (data[ZIK_CAPTURE_FILE_HEADER_LEN - 1] != ZIK_CAPTURE_VERSION) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "%s: unsupported capture version %u", filename,
+        data[ZIK_CAPTURE_FILE_HEADER_LEN - 1]);
+    return FALSE;
+  }
+
+  data += ZIK_CAPTURE_FILE_HEADER_LEN;
+
+  while (data < end) {
+    ZikReplayRecord rec;
+
+    if (end - data < ZIK_CAPTURE_RECORD_HEADER_LEN)
+      goto truncated;
+
+    if (data[0] != ZIK_CAPTURE_OUTGOING && data[0] != ZIK_CAPTURE_INCOMING) {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+          "%s: invalid direction %u at record %u", filename, data[0],
+          self->records->len);
+      return FALSE;
+    }
+
+    timestamp += ((guint32) data[1] << 24) | (data[2] << 16) |
+        (data[3] << 8) | data[4];
+
+    rec.direction = data[0];
+    rec.timestamp = timestamp;
+    rec.size = (data[5] << 8) | data[6];
+    rec.data = data + ZIK_CAPTURE_RECORD_HEADER_LEN;
+    rec.prev_out = prev_out;
+    rec.done = 0;
+
+    if ((gsize) (end - rec.data) < rec.size)
+      goto truncated;
+
+    if (rec.direction == ZIK_CAPTURE_OUTGOING)
+      prev_out = self->records->len;
+
+    g_array_append_val (self->records, rec);
+    data = rec.data + rec.size;
+  }
+
+  return TRUE;
+
+truncated:
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+      "%s: truncated record %u", filename, self->records->len);
+  return FALSE;
+}
+
+/* Make a transport which plays the device of a capture: frames sent are
+ * checked against captured outgoing ones and captured incoming frames are
+ * received in order, each once all frames preceding it have been sent.
+ *
+ * @timed: keep delays of capture, otherwise frames are delivered as soon as
+ *   possible */
+ZikTransport *
+zik_transport_new_for_capture (const gchar * filename, gboolean timed,
+    GError ** error)
+{
+  ZikReplayTransport *self;
+  gchar *contents;
+  gsize length;
+
+  if (!g_file_get_contents (filename, &contents, &length, error))
+    return NULL;
+
+  self = zik_transport_new (&zik_replay_transport_funcs,
+      sizeof (ZikReplayTransport));
+  self->contents = contents;
+  self->records = g_array_new (FALSE, FALSE, sizeof (ZikReplayRecord));
+  self->timed = timed;
+
+  if (!zik_replay_transport_parse (self, filename, length, error)) {
+    zik_transport_unref ((ZikTransport *) self);
+    return NULL;
+  }
+
+  self->start = g_get_monotonic_time ();
+  self->out_index = zik_replay_transport_next (self, 0, ZIK_CAPTURE_OUTGOING);
+  self->in_index = zik_replay_transport_next (self, 0, ZIK_CAPTURE_INCOMING);
+
+  return (ZikTransport *) self;
+}
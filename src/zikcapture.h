@@ -0,0 +1,57 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIK_CAPTURE_H
+#define ZIK_CAPTURE_H
+
+#include <glib.h>
+
+#include "ziktransport.h"
+
+G_BEGIN_DECLS
+
+/* Capture file layout, integers being big endian:
+ *
+ * "ZIKCAP" 0x00 version(1)
+ * records of:
+ *   direction(1) time since previous record in us(4) size(2) frame(size)
+ */
+#define ZIK_CAPTURE_MAGIC "ZIKCAP"
+#define ZIK_CAPTURE_VERSION 1
+
+typedef struct _ZikCapture ZikCapture;
+
+typedef enum
+{
+  ZIK_CAPTURE_OUTGOING = 0,
+  ZIK_CAPTURE_INCOMING = 1
+} ZikCaptureDirection;
+
+ZikCapture *zik_capture_new (const gchar * filename, GError ** error);
+ZikCapture *zik_capture_ref (ZikCapture * capture);
+void zik_capture_unref (ZikCapture * capture);
+
+void zik_capture_add_frame (ZikCapture * capture,
+    ZikCaptureDirection direction, const guint8 * header, gsize header_size,
+    const guint8 * payload, gsize payload_size);
+
+ZikTransport *zik_transport_new_for_capture (const gchar * filename,
+    gboolean timed, GError ** error);
+
+G_END_DECLS
+
+#endif
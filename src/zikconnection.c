@@ -17,40 +17,145 @@
 
 #include <gio/gio.h>
 
+#include <string.h>
+
 #include "zikconnection.h"
+#include "zikapi.h"
+
+/* maximum number of requests written by a single send */
+#define ZIK_CONNECTION_MAX_BATCH 16
+
+/* a message queued on the connection, waiting to be sent then answered */
+typedef struct
+{
+  ZikConnection *conn;
+  ZikMessage *msg;
+  gboolean owns_msg;
+
+  /* path/method the answer is expected to carry, NULL for session messages
+   * which are sent alone on the link */
+  const gchar *path;
+  gsize path_len;
+
+  /* message is sent from header and its payload in place */
+  guint8 header[ZIK_MESSAGE_HEADER_LEN];
+  const gchar *payload;
+  gsize size;
+  gsize written;
+
+  /* fed with answer while it is received, owned by caller */
+  ZikReplyParser *parser;
+
+  GSource *timeout_source;
+  GSource *cancel_source;
+
+  /* task has already been returned because of timeout or cancellation but
+   * request stays queued if it has been sent, to drop its answer */
+  gboolean expired;
+} Request;
+
+/* answer deadline in ms, for paths which need a different one than
+ * ZIK_CONNECTION_DEFAULT_TIMEOUT */
+static const guint path_timeouts[ZIK_N_API_PATHS] = {
+  /* device may have to query the phone */
+  [ZIK_API_PATH_AUDIO_TRACK_METADATA] = 10000,
+  /* changing name restarts part of bluetooth stack */
+  [ZIK_API_PATH_BLUETOOTH_FRIENDLY_NAME] = 10000,
+  /* cheap values polled frequently, fail fast */
+  [ZIK_API_PATH_AUDIO_VOLUME] = 2000,
+  [ZIK_API_PATH_AUDIO_SOURCE] = 2000,
+  [ZIK_API_PATH_SYSTEM_BATTERY] = 2000,
+};
+
+/* time in ms a request which expired once sent keeps waiting for its
+ * answer, it is considered lost after that */
+#define ZIK_CONNECTION_TOMBSTONE_TIMEOUT 10000
 
 struct _ZikConnection
 {
   gint ref_count;
 
-  GSocket *socket;
-  guint8 *recv_buffer;
-  gsize recv_buffer_size;
+  ZikTransport *transport;
+  GMainContext *context;
+  GSource *in_source;
+  GSource *out_source;
+
+  /* queue of GTask, the n_sent first ones are waiting for their answer and
+   * the next one is the one being sent */
+  GQueue requests;
+  guint n_sent;
+  guint max_in_flight;
+  gboolean closed;
+
+  ZikMessageDecoder *decoder;
+
+  /* records frames when set */
+  ZikCapture *capture;
 };
 
 G_DEFINE_BOXED_TYPE (ZikConnection, zik_connection, zik_connection_ref,
     zik_connection_unref);
 
+static guint default_max_in_flight = ZIK_CONNECTION_DEFAULT_MAX_IN_FLIGHT;
+static ZikCapture *default_capture = NULL;
+
+static gboolean zik_connection_on_input (ZikTransport * transport,
+    GIOCondition condition, gpointer userdata);
+static void zik_connection_process (ZikConnection * conn);
+
 ZikConnection *
 zik_connection_new (int fd)
+{
+  return zik_connection_new_with_context (fd, NULL);
+}
+
+/* @context: (allow-none): main context used to watch the socket, thread
+ * default one if NULL */
+ZikConnection *
+zik_connection_new_with_context (gint fd, GMainContext * context)
+{
+  ZikConnection *conn;
+  ZikTransport *transport;
+
+  transport = zik_transport_new_for_fd (fd);
+  if (transport == NULL)
+    return NULL;
+
+  conn = zik_connection_new_for_transport (transport, context);
+  zik_transport_unref (transport);
+
+  return conn;
+}
+
+/* @context: (allow-none): main context used to watch the transport, thread
+ * default one if NULL */
+ZikConnection *
+zik_connection_new_for_transport (ZikTransport * transport,
+    GMainContext * context)
 {
   ZikConnection *conn;
-  GError *error = NULL;
 
   conn = g_slice_new0 (ZikConnection);
   conn->ref_count = 1;
-  conn->socket = g_socket_new_from_fd (fd, &error);
+  conn->transport = zik_transport_ref (transport);
 
-  if (conn->socket == NULL) {
-    g_critical ("failed to create socket from fd %d: %s", fd, error->message);
-    g_error_free (error);
-    g_slice_free (ZikConnection, conn);
-    return NULL;
-  }
+  if (context)
+    conn->context = g_main_context_ref (context);
+  else
+    conn->context = g_main_context_ref_thread_default ();
+
+  g_queue_init (&conn->requests);
+  conn->max_in_flight = default_max_in_flight;
 
-  /* message size is stored to an uint16_t so make receive buffer accordingly */
-  conn->recv_buffer_size = G_MAXUINT16;
-  conn->recv_buffer = g_malloc (conn->recv_buffer_size);
+  conn->decoder = zik_message_decoder_new ();
+
+  if (default_capture)
+    conn->capture = zik_capture_ref (default_capture);
+
+  /* input is always watched so that hang up is noticed even when idle */
+  conn->in_source = zik_transport_create_watch (conn->transport,
+      G_IO_IN | G_IO_HUP | G_IO_ERR, zik_connection_on_input, conn, NULL);
+  g_source_attach (conn->in_source, conn->context);
 
   return conn;
 }
@@ -66,14 +171,695 @@ void
 zik_connection_unref (ZikConnection * conn)
 {
   if (g_atomic_int_dec_and_test (&conn->ref_count)) {
-    if (conn->socket)
-      g_object_unref (conn->socket);
+    /* queued requests hold a reference so queue is empty here */
+    if (conn->out_source) {
+      g_source_destroy (conn->out_source);
+      g_source_unref (conn->out_source);
+    }
+
+    if (conn->in_source) {
+      g_source_destroy (conn->in_source);
+      g_source_unref (conn->in_source);
+    }
 
-    g_free (conn->recv_buffer);
+    zik_transport_unref (conn->transport);
+
+    if (conn->capture)
+      zik_capture_unref (conn->capture);
+
+    g_main_context_unref (conn->context);
+    zik_message_decoder_free (conn->decoder);
     g_slice_free (ZikConnection, conn);
   }
 }
 
+/* stop watching deadline and cancellation */
+static void
+request_disarm (Request * req)
+{
+  if (req->timeout_source) {
+    g_source_destroy (req->timeout_source);
+    g_source_unref (req->timeout_source);
+    req->timeout_source = NULL;
+  }
+
+  if (req->cancel_source) {
+    g_source_destroy (req->cancel_source);
+    g_source_unref (req->cancel_source);
+    req->cancel_source = NULL;
+  }
+}
+
+static void
+request_free (Request * req)
+{
+  request_disarm (req);
+
+  if (req->owns_msg)
+    zik_message_free (req->msg);
+
+  zik_connection_unref (req->conn);
+  g_slice_free (Request, req);
+}
+
+/* complete the nth sent request, takes ownership of answer or error */
+static void
+zik_connection_complete (ZikConnection * conn, guint n, ZikMessage * answer,
+    GError * error)
+{
+  GTask *task;
+  Request *req;
+
+  task = g_queue_pop_nth (&conn->requests, n);
+  req = g_task_get_task_data (task);
+  if (n < conn->n_sent)
+    conn->n_sent--;
+
+  if (req->expired) {
+    /* caller has already been told */
+    if (error)
+      g_error_free (error);
+    else
+      zik_message_free (answer);
+  } else {
+    request_disarm (req);
+
+    if (error)
+      g_task_return_error (task, error);
+    else
+      g_task_return_pointer (task, answer, (GDestroyNotify) zik_message_free);
+  }
+
+  g_object_unref (task);
+}
+
+/* answer of an expired request never came, stop waiting for it so that it
+ * doesn't hold an in flight slot forever */
+static gboolean
+zik_connection_on_tombstone_timeout (gpointer userdata)
+{
+  GTask *task = (GTask *) userdata;
+  Request *req = g_task_get_task_data (task);
+  ZikConnection *conn = req->conn;
+  gint n;
+
+  n = g_queue_index (&conn->requests, task);
+  g_return_val_if_fail (n >= 0, G_SOURCE_REMOVE);
+
+  /* dropping it while partially written would break the stream */
+  if (n >= (gint) conn->n_sent)
+    return G_SOURCE_CONTINUE;
+
+  if (req->path)
+    g_warning ("ZikConnection %p: answer to '%.*s' lost", conn,
+        (gint) req->path_len, req->path);
+  else
+    g_warning ("ZikConnection %p: answer to session request lost", conn);
+
+  zik_connection_ref (conn);
+  zik_connection_complete (conn, n, NULL,
+      g_error_new_literal (G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "answer lost"));
+  zik_connection_process (conn);
+  zik_connection_unref (conn);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* return task before its answer has been received, takes ownership of
+ * error */
+static void
+zik_connection_expire (ZikConnection * conn, GTask * task, GError * error)
+{
+  Request *req = g_task_get_task_data (task);
+  gint n;
+
+  request_disarm (req);
+  req->expired = TRUE;
+  req->parser = NULL;
+
+  n = g_queue_index (&conn->requests, task);
+
+  if (n >= (gint) conn->n_sent && req->written == 0) {
+    /* not on the link yet, forget it, this may unblock following ones */
+    zik_connection_ref (conn);
+    g_queue_remove (&conn->requests, task);
+    g_task_return_error (task, error);
+    g_object_unref (task);
+    zik_connection_process (conn);
+    zik_connection_unref (conn);
+    return;
+  }
+
+  /* keep a tombstone until answer arrives so that it isn't taken for the
+   * answer of another request, or until it is deemed lost, and make sure
+   * message outlives caller */
+  req->timeout_source = g_timeout_source_new (ZIK_CONNECTION_TOMBSTONE_TIMEOUT);
+  g_source_set_callback (req->timeout_source,
+      zik_connection_on_tombstone_timeout, task, NULL);
+  g_source_attach (req->timeout_source, conn->context);
+
+  if (!req->owns_msg) {
+    req->msg = zik_message_copy (req->msg);
+    req->owns_msg = TRUE;
+
+    if (req->path)
+      req->path = zik_message_peek_request_path (req->msg, &req->path_len);
+    req->payload = zik_message_peek_payload (req->msg, &req->size);
+    req->size += ZIK_MESSAGE_HEADER_LEN;
+  }
+
+  g_task_return_error (task, error);
+}
+
+static gboolean
+zik_connection_on_timeout (gpointer userdata)
+{
+  GTask *task = (GTask *) userdata;
+  Request *req = g_task_get_task_data (task);
+
+  if (req->path)
+    g_warning ("ZikConnection %p: request '%.*s' timed out", req->conn,
+        (gint) req->path_len, req->path);
+  else
+    g_warning ("ZikConnection %p: session request timed out", req->conn);
+
+  zik_connection_expire (req->conn, task,
+      g_error_new_literal (G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+          "no answer received before deadline"));
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+zik_connection_on_cancelled (GCancellable * cancellable, gpointer userdata)
+{
+  GTask *task = (GTask *) userdata;
+  Request *req = g_task_get_task_data (task);
+
+  zik_connection_expire (req->conn, task,
+      g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+          "request was cancelled"));
+
+  return G_SOURCE_REMOVE;
+}
+
+static guint
+zik_connection_get_timeout (const gchar * path, gsize path_len)
+{
+  ZikApiPathId id;
+
+  if (path == NULL)
+    return ZIK_CONNECTION_DEFAULT_TIMEOUT;
+
+  id = zik_api_path_lookup_request (path, path_len);
+  if (id == ZIK_API_PATH_UNKNOWN || path_timeouts[id] == 0)
+    return ZIK_CONNECTION_DEFAULT_TIMEOUT;
+
+  return path_timeouts[id];
+}
+
+/* link is unusable: fail every queued request */
+static void
+zik_connection_fail (ZikConnection * conn, const GError * error)
+{
+  conn->closed = TRUE;
+
+  if (conn->out_source) {
+    g_source_destroy (conn->out_source);
+    g_source_unref (conn->out_source);
+    conn->out_source = NULL;
+  }
+
+  conn->n_sent = 0;
+
+  while (!g_queue_is_empty (&conn->requests))
+    zik_connection_complete (conn, 0, NULL, g_error_copy (error));
+}
+
+static gboolean
+zik_connection_on_output (ZikTransport * transport, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikConnection *conn = (ZikConnection *) userdata;
+
+  g_source_unref (conn->out_source);
+  conn->out_source = NULL;
+
+  zik_connection_ref (conn);
+  zik_connection_process (conn);
+  zik_connection_unref (conn);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* write as much of requests as possible with a single send, header and
+ * payload of each request being a vector. Return FALSE if link failed */
+static gboolean
+zik_connection_write (ZikConnection * conn, Request ** reqs, guint n_reqs)
+{
+  GOutputVector vectors[2 * ZIK_CONNECTION_MAX_BATCH];
+  GError *error = NULL;
+  gint n_vectors = 0;
+  gssize sbytes;
+  guint i;
+
+  for (i = 0; i < n_reqs; i++) {
+    Request *req = reqs[i];
+    gsize header_size = ZIK_MESSAGE_HEADER_LEN;
+
+    /* only first request can have been partially written */
+    if (req->written < header_size) {
+      vectors[n_vectors].buffer = req->header + req->written;
+      vectors[n_vectors].size = header_size - req->written;
+      n_vectors++;
+    }
+
+    if (req->size > header_size) {
+      gsize offset = MAX (req->written, header_size) - header_size;
+
+      vectors[n_vectors].buffer = req->payload + offset;
+      vectors[n_vectors].size = req->size - header_size - offset;
+      n_vectors++;
+    }
+  }
+
+  sbytes = zik_transport_send (conn->transport, vectors, n_vectors, &error);
+  if (sbytes < 0) {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_error_free (error);
+      return TRUE;
+    }
+
+    g_critical ("ZikConnection %p: failed to send data: %s",
+        conn, error->message);
+    zik_connection_fail (conn, error);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  for (i = 0; i < n_reqs && sbytes > 0; i++) {
+    gsize count = MIN ((gsize) sbytes, reqs[i]->size - reqs[i]->written);
+
+    reqs[i]->written += count;
+    sbytes -= count;
+
+    if (conn->capture && reqs[i]->written == reqs[i]->size)
+      zik_capture_add_frame (conn->capture, ZIK_CAPTURE_OUTGOING,
+          reqs[i]->header, ZIK_MESSAGE_HEADER_LEN,
+          (const guint8 *) reqs[i]->payload,
+          reqs[i]->size - ZIK_MESSAGE_HEADER_LEN);
+  }
+
+  return TRUE;
+}
+
+static void
+zik_connection_wait_writable (ZikConnection * conn)
+{
+  conn->out_source = zik_transport_create_watch (conn->transport, G_IO_OUT,
+      zik_connection_on_output, conn, NULL);
+  g_source_attach (conn->out_source, conn->context);
+}
+
+static Request *
+zik_connection_get_request (ZikConnection * conn, guint n)
+{
+  GTask *task;
+
+  task = g_queue_peek_nth (&conn->requests, n);
+  if (task == NULL)
+    return NULL;
+
+  return g_task_get_task_data (task);
+}
+
+/* send queued requests until max_in_flight of them wait for their answer,
+ * or wait for transport to be writable */
+static void
+zik_connection_process (ZikConnection * conn)
+{
+  Request *reqs[ZIK_CONNECTION_MAX_BATCH];
+  guint n_reqs;
+  guint i;
+
+  if (conn->out_source || conn->closed)
+    return;
+
+  for (;;) {
+    /* gather every request which can be sent now to write them at once */
+    for (n_reqs = 0; n_reqs < ZIK_CONNECTION_MAX_BATCH; n_reqs++) {
+      guint n = conn->n_sent + n_reqs;
+      Request *req;
+
+      if (n >= conn->max_in_flight)
+        break;
+
+      req = zik_connection_get_request (conn, n);
+      if (req == NULL)
+        break;
+
+      /* session messages are not pipelined with anything else */
+      if (n > 0 && (req->path == NULL ||
+              zik_connection_get_request (conn, 0)->path == NULL))
+        break;
+
+      reqs[n_reqs] = req;
+    }
+
+    if (n_reqs == 0)
+      return;
+
+    if (!zik_connection_write (conn, reqs, n_reqs))
+      return;
+
+    /* fully written requests wait for answer */
+    for (i = 0; i < n_reqs && reqs[i]->written == reqs[i]->size; i++)
+      conn->n_sent++;
+
+    if (i < n_reqs) {
+      zik_connection_wait_writable (conn);
+      return;
+    }
+  }
+}
+
+/* answers come back in order, but check the path carried by the answer and
+ * look for the request it belongs to if it doesn't match head one. Fall back
+ * to head if nothing matches, firmware may not echo path as expected */
+static guint
+zik_connection_match_answer (ZikConnection * conn, ZikMessage * answer)
+{
+  const gchar *path;
+  gsize path_len;
+  guint i;
+
+  if (!zik_message_is_request (answer))
+    return 0;
+
+  path = zik_message_peek_request_reply_path (answer, &path_len);
+  if (path == NULL)
+    return 0;
+
+  for (i = 0; i < conn->n_sent; i++) {
+    Request *req = zik_connection_get_request (conn, i);
+
+    if (req->path && req->path_len == path_len &&
+        memcmp (req->path, path, path_len) == 0) {
+      if (i > 0)
+        g_warning ("ZikConnection %p: answer to '%.*s' received out of order",
+            conn, (gint) path_len, path);
+
+      return i;
+    }
+  }
+
+  g_debug ("ZikConnection %p: answer path '%.*s' doesn't match any request",
+      conn, (gint) path_len, path);
+  return 0;
+}
+
+/* @answer: (transfer full) */
+static void
+zik_connection_handle_answer (ZikConnection * conn, ZikMessage * answer)
+{
+  Request *head;
+  guint n;
+
+  if (conn->n_sent == 0) {
+    g_warning ("ZikConnection %p: dropping unsolicited message", conn);
+    zik_message_free (answer);
+    return;
+  }
+
+  /* head request parser has been fed with this answer */
+  head = zik_connection_get_request (conn, 0);
+
+  /* depending on the sent message, it could be an ack or a request answer */
+  if (!zik_message_is_acknowledge (answer) &&
+      !zik_message_is_request (answer)) {
+    g_warning ("ZikConnection %p: bad answer type", conn);
+    zik_message_free (answer);
+    zik_connection_complete (conn, 0, NULL,
+        g_error_new_literal (G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+            "unexpected answer type"));
+    return;
+  }
+
+  n = zik_connection_match_answer (conn, answer);
+  if (n != 0 && head->parser)
+    zik_reply_parser_reset (head->parser);
+
+  zik_connection_complete (conn, n, answer, NULL);
+}
+
+/* let head request parse its answer while it is being received, parsing
+ * is completed by its caller with the full answer */
+static void
+zik_connection_feed_answer (ZikConnection * conn)
+{
+  Request *req;
+  const gchar *payload;
+  gsize size;
+
+  if (conn->n_sent == 0)
+    return;
+
+  req = zik_connection_get_request (conn, 0);
+  if (req->parser == NULL)
+    return;
+
+  payload = zik_message_decoder_peek_request_payload (conn->decoder, &size);
+  if (payload == NULL)
+    return;
+
+  zik_reply_parser_feed (req->parser, payload, size);
+}
+
+static void
+zik_connection_capture_answer (ZikConnection * conn, ZikMessage * answer)
+{
+  guint8 header[ZIK_MESSAGE_HEADER_LEN];
+  const gchar *payload;
+  gsize size;
+
+  zik_message_write_header (answer, header);
+  payload = zik_message_peek_payload (answer, &size);
+  zik_capture_add_frame (conn->capture, ZIK_CAPTURE_INCOMING, header,
+      sizeof (header), (const guint8 *) payload, size);
+}
+
+static gboolean
+zik_connection_on_input (ZikTransport * transport, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikConnection *conn = (ZikConnection *) userdata;
+  ZikMessage *answer;
+  GError *error = NULL;
+  guint8 *buffer;
+  gsize size;
+  gssize rbytes;
+
+  /* completing requests may drop the last external reference */
+  zik_connection_ref (conn);
+
+  /* read as much as available, it may hold several messages or only part of
+   * one */
+  buffer = zik_message_decoder_get_buffer (conn->decoder, &size);
+  rbytes = zik_transport_receive (conn->transport, buffer, size, &error);
+  if (rbytes < 0) {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_error_free (error);
+      goto done;
+    }
+
+    g_critical ("ZikConnection %p: failed to receive data: %s",
+        conn, error->message);
+    zik_connection_fail (conn, error);
+    g_error_free (error);
+    goto closed;
+  } else if (rbytes == 0) {
+    g_warning ("ZikConnection %p: connection was closed while receiving",
+        conn);
+    error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED,
+        "connection closed by remote");
+    zik_connection_fail (conn, error);
+    g_error_free (error);
+    goto closed;
+  }
+
+  zik_message_decoder_commit (conn->decoder, rbytes);
+
+  for (;;) {
+    zik_connection_feed_answer (conn);
+
+    answer = zik_message_decoder_pop (conn->decoder, &error);
+    if (answer == NULL)
+      break;
+
+    if (conn->capture)
+      zik_connection_capture_answer (conn, answer);
+
+    zik_connection_handle_answer (conn, answer);
+  }
+
+  if (error) {
+    /* framing is lost, there is no way to resynchronize on stream */
+    g_critical ("ZikConnection %p: failed to decode received data: %s",
+        conn, error->message);
+    zik_connection_fail (conn, error);
+    g_error_free (error);
+    goto closed;
+  }
+
+  zik_connection_process (conn);
+
+done:
+  zik_connection_unref (conn);
+  return G_SOURCE_CONTINUE;
+
+closed:
+  g_source_unref (conn->in_source);
+  conn->in_source = NULL;
+  zik_connection_unref (conn);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+zik_connection_queue_message (ZikConnection * conn, ZikMessage * msg,
+    gboolean owns_msg, ZikReplyParser * parser, GCancellable * cancellable,
+    GAsyncReadyCallback callback, gpointer userdata)
+{
+  GTask *task;
+  Request *req;
+
+  task = g_task_new (NULL, cancellable, callback, userdata);
+
+  req = g_slice_new0 (Request);
+  req->conn = zik_connection_ref (conn);
+  req->msg = msg;
+  req->owns_msg = owns_msg;
+  req->parser = parser;
+  if (zik_message_is_request (msg))
+    req->path = zik_message_peek_request_path (msg, &req->path_len);
+  g_task_set_task_data (task, req, (GDestroyNotify) request_free);
+
+  if (!zik_message_write_header (msg, req->header)) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        "message is too big");
+    g_object_unref (task);
+    return;
+  }
+
+  if (conn->closed) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CLOSED,
+        "connection is closed");
+    g_object_unref (task);
+    return;
+  }
+
+  req->payload = zik_message_peek_payload (msg, &req->size);
+  req->size += ZIK_MESSAGE_HEADER_LEN;
+
+  /* sources are destroyed before task is completed so they don't need to
+   * hold a reference on it */
+  req->timeout_source = g_timeout_source_new (zik_connection_get_timeout (
+          req->path, req->path_len));
+  g_source_set_callback (req->timeout_source, zik_connection_on_timeout,
+      task, NULL);
+  g_source_attach (req->timeout_source, conn->context);
+
+  if (cancellable) {
+    req->cancel_source = g_cancellable_source_new (cancellable);
+    g_source_set_callback (req->cancel_source,
+        (GSourceFunc) (GCallback) zik_connection_on_cancelled, task, NULL);
+    g_source_attach (req->cancel_source, conn->context);
+  }
+
+  g_queue_push_tail (&conn->requests, task);
+
+  /* write from main context rather than now so that requests queued
+   * together are gathered in a single send */
+  if (conn->out_source == NULL)
+    zik_connection_wait_writable (conn);
+}
+
+/* @msg: (transfer full)
+ *
+ * Queue @msg on @conn. @callback is invoked from the thread default main
+ * context of the caller once the answer has been received. Socket is watched
+ * from the main context given at connection creation so it shall be
+ * running. */
+void
+zik_connection_send_message_async (ZikConnection * conn, ZikMessage * msg,
+    GCancellable * cancellable, GAsyncReadyCallback callback,
+    gpointer userdata)
+{
+  zik_connection_queue_message (conn, msg, TRUE, NULL, cancellable, callback,
+      userdata);
+}
+
+/* Return: (transfer full): the answer or NULL on error */
+ZikMessage *
+zik_connection_send_message_finish (ZikConnection * conn, GAsyncResult * res,
+    GError ** error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/* Set the number of requests which can wait for their answer at the same
+ * time on connections created afterward, 1 means lockstep */
+void
+zik_connection_set_default_max_in_flight (guint max_in_flight)
+{
+  g_return_if_fail (max_in_flight > 0);
+
+  default_max_in_flight = max_in_flight;
+}
+
+/* Record traffic of connections created afterward to @capture, NULL to stop
+ * capturing */
+void
+zik_connection_set_default_capture (ZikCapture * capture)
+{
+  if (default_capture)
+    zik_capture_unref (default_capture);
+
+  default_capture = capture ? zik_capture_ref (capture) : NULL;
+}
+
+void
+zik_connection_set_capture (ZikConnection * conn, ZikCapture * capture)
+{
+  if (conn->capture)
+    zik_capture_unref (conn->capture);
+
+  conn->capture = capture ? zik_capture_ref (capture) : NULL;
+}
+
+void
+zik_connection_set_max_in_flight (ZikConnection * conn, guint max_in_flight)
+{
+  g_return_if_fail (max_in_flight > 0);
+
+  conn->max_in_flight = max_in_flight;
+  zik_connection_process (conn);
+}
+
+guint
+zik_connection_get_max_in_flight (ZikConnection * conn)
+{
+  return conn->max_in_flight;
+}
+
+/* transfer none */
+GMainContext *
+zik_connection_get_context (ZikConnection * conn)
+{
+  return conn->context;
+}
+
 gboolean
 zik_connection_open_session (ZikConnection * conn)
 {
@@ -100,73 +886,88 @@ zik_connection_close_session (ZikConnection * conn)
   return ret;
 }
 
-gboolean
-zik_connection_send_message (ZikConnection * conn, ZikMessage * msg,
-    ZikMessage ** out_answer)
+typedef struct
 {
-  gboolean ret = FALSE;
-  GError *error = NULL;
-  guint8 *data;
-  gsize size;
-  gssize sbytes, rbytes;
+  gboolean done;
   ZikMessage *answer;
+  GError *error;
+} SyncData;
 
-  data = zik_message_make_buffer (msg, &size);
+static void
+zik_connection_send_message_sync_cb (GObject * source, GAsyncResult * res,
+    gpointer userdata)
+{
+  SyncData *data = (SyncData *) userdata;
 
-  /* send data */
-  sbytes = g_socket_send (conn->socket, (gchar *) data, size, NULL, &error);
-  if (sbytes < 0) {
-    g_critical ("ZikConnection %p: failed to send data to socket: %s",
-        conn, error->message);
-    g_error_free (error);
-    goto done;
-  } else if ((gsize) sbytes < size) {
-    g_warning ("ZikConnection %p: failed to send all data: %" G_GSSIZE_FORMAT
-        "/%" G_GSIZE_FORMAT, conn, sbytes, size);
-    goto done;
-  }
+  data->answer = g_task_propagate_pointer (G_TASK (res), &data->error);
+  data->done = TRUE;
+}
 
-  /* wait for answer */
-  rbytes = g_socket_receive_with_blocking (conn->socket,
-      (gchar *) conn->recv_buffer, conn->recv_buffer_size, TRUE, NULL, &error);
-  if (rbytes < 0) {
-    g_critical ("ZikConnection %p: failed to receive data from socket: %s",
-        conn, error->message);
-    g_error_free (error);
-    goto done;
-  } else if (rbytes == 0) {
-    g_warning ("ZikConnection %p: connection was closed while receiving",
-        conn);
-    goto done;
-  } else if (rbytes < 3) {
-    g_warning ("ZikConnection %p: not enough data in answer: %" G_GSSIZE_FORMAT,
-        conn, rbytes);
-  }
+/* iterate the connection main context until answer to @msg is received */
+static gboolean
+zik_connection_send_message_sync (ZikConnection * conn, ZikMessage * msg,
+    ZikReplyParser * parser, ZikMessage ** out_answer, GError ** error)
+{
+  SyncData data = { FALSE, NULL, NULL };
 
-  answer = zik_message_new_from_buffer (conn->recv_buffer, rbytes);
-  if (answer == NULL) {
-    g_warning ("ZikConnection %p: failed to make message from received buffer",
-        conn);
-    goto done;
-  }
+  g_main_context_push_thread_default (conn->context);
 
-  /* depending on the sent message, it could be an ack or a request answer */
-  if (!zik_message_is_acknowledge (answer) &&
-      !zik_message_is_request (answer)) {
-    g_warning ("ZikConnection %p: bad answer %02x %02x %02x", conn,
-        conn->recv_buffer[0], conn->recv_buffer[1], conn->recv_buffer[2]);
-    zik_message_free (answer);
-    goto done;
+  zik_connection_queue_message (conn, msg, FALSE, parser, NULL,
+      zik_connection_send_message_sync_cb, &data);
+
+  while (!data.done)
+    g_main_context_iteration (conn->context, TRUE);
+
+  g_main_context_pop_thread_default (conn->context);
+
+  if (data.answer == NULL) {
+    g_propagate_error (error, data.error);
+    return FALSE;
   }
 
   if (out_answer != NULL)
-    *out_answer = answer;
+    *out_answer = data.answer;
   else
-    zik_message_free (answer);
+    zik_message_free (data.answer);
 
-  ret = TRUE;
+  return TRUE;
+}
 
-done:
-  g_free (data);
-  return ret;
+/* synchronous version of zik_connection_send_message_async(), iterate the
+ * connection main context until answer is received */
+gboolean
+zik_connection_send_message (ZikConnection * conn, ZikMessage * msg,
+    ZikMessage ** out_answer)
+{
+  return zik_connection_send_message_with_parser (conn, msg, NULL,
+      out_answer);
+}
+
+/* Same as zik_connection_send_message() but answer is fed to @parser as it
+ * is received. Parsing is to be completed with the returned answer */
+gboolean
+zik_connection_send_message_with_parser (ZikConnection * conn,
+    ZikMessage * msg, ZikReplyParser * parser, ZikMessage ** out_answer)
+{
+  GError *error = NULL;
+
+  if (!zik_connection_send_message_sync (conn, msg, parser, out_answer,
+          &error)) {
+    g_warning ("ZikConnection %p: request failed: %s", conn,
+        error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Same as zik_connection_send_message() but failure is reported to caller
+ * through @error instead of being logged */
+gboolean
+zik_connection_send_message_with_error (ZikConnection * conn,
+    ZikMessage * msg, ZikMessage ** out_answer, GError ** error)
+{
+  return zik_connection_send_message_sync (conn, msg, NULL, out_answer,
+      error);
 }
@@ -19,26 +19,57 @@
 #define ZIK_CONNECTION_H
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "zikmessage.h"
+#include "ziktransport.h"
+#include "zikcapture.h"
 
 G_BEGIN_DECLS
 
 #define ZIK_CONNECTION_TYPE (zik_connection_get_type ())
 
+/* number of requests waiting for their answer at the same time */
+#define ZIK_CONNECTION_DEFAULT_MAX_IN_FLIGHT 4
+
+/* time in ms to receive an answer once request has been queued */
+#define ZIK_CONNECTION_DEFAULT_TIMEOUT 5000
+
 typedef struct _ZikConnection ZikConnection;
 
 GType zik_connection_get_type (void);
 
 ZikConnection *zik_connection_new (gint fd);
+ZikConnection *zik_connection_new_with_context (gint fd,
+    GMainContext * context);
+ZikConnection *zik_connection_new_for_transport (ZikTransport * transport,
+    GMainContext * context);
 ZikConnection *zik_connection_ref (ZikConnection * conn);
 void zik_connection_unref (ZikConnection * conn);
 
+void zik_connection_set_default_max_in_flight (guint max_in_flight);
+void zik_connection_set_max_in_flight (ZikConnection * conn,
+    guint max_in_flight);
+guint zik_connection_get_max_in_flight (ZikConnection * conn);
+void zik_connection_set_default_capture (ZikCapture * capture);
+void zik_connection_set_capture (ZikConnection * conn, ZikCapture * capture);
+GMainContext *zik_connection_get_context (ZikConnection * conn);
+
 gboolean zik_connection_open_session (ZikConnection * conn);
 gboolean zik_connection_close_session (ZikConnection * conn);
 
 gboolean zik_connection_send_message (ZikConnection * conn, ZikMessage * msg,
     ZikMessage ** out_answer);
+gboolean zik_connection_send_message_with_parser (ZikConnection * conn,
+    ZikMessage * msg, ZikReplyParser * parser, ZikMessage ** out_answer);
+gboolean zik_connection_send_message_with_error (ZikConnection * conn,
+    ZikMessage * msg, ZikMessage ** out_answer, GError ** error);
+
+void zik_connection_send_message_async (ZikConnection * conn, ZikMessage * msg,
+    GCancellable * cancellable, GAsyncReadyCallback callback,
+    gpointer userdata);
+ZikMessage *zik_connection_send_message_finish (ZikConnection * conn,
+    GAsyncResult * res, GError ** error);
 
 G_END_DECLS
 
@@ -0,0 +1,715 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "zikemulator.h"
+#include "zikapi.h"
+
+#define ALL_MODELS (ZIK_EMULATOR_MODEL_ZIK2 | ZIK_EMULATOR_MODEL_ZIK3)
+#define ZIK2_ONLY ZIK_EMULATOR_MODEL_ZIK2
+#define ZIK3_ONLY ZIK_EMULATOR_MODEL_ZIK3
+
+#define XML_HEADER "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+
+/* An API path of the device.
+ *
+ * get: body of <answer> for get method, {key} being replaced by the value of
+ *      key in state
+ * set: state keys changed by set method, space separated. First one takes
+ *      arg value and the following ones the values of next &name=value
+ * toggle: state key switched by enable/disable methods
+ *
+ * Any other method is an action which is acknowledged with an empty answer */
+typedef struct
+{
+  const gchar *path;
+  guint models;
+  const gchar *get;
+  const gchar *set;
+  const gchar *toggle;
+} ZikEmulatorApi;
+
+static const ZikEmulatorApi api_table[] = {
+  /* account and application */
+  { "/api/account/username", ALL_MODELS,
+    "<account username=\"{username}\"/>", "username", NULL },
+  { "/api/appli_version", ALL_MODELS, NULL, "appli_version", NULL },
+
+  /* audio */
+  { ZIK_API_AUDIO_TRACK_METADATA_PATH, ALL_MODELS,
+    "<audio><track><metadata playing=\"{playing}\" title=\"{title}\" "
+    "artist=\"{artist}\" album=\"{album}\" genre=\"{genre}\"/></track></audio>",
+    NULL, NULL },
+  { ZIK_API_AUDIO_NOISE_CONTROL_ENABLED_PATH, ALL_MODELS,
+    "<audio><noise_control enabled=\"{nc_enabled}\"/></audio>",
+    "nc_enabled", NULL },
+  { ZIK_API_AUDIO_NOISE_CONTROL_PATH, ZIK2_ONLY,
+    "<audio><noise_control type=\"{nc_type}\" value=\"{nc_value}\"/></audio>",
+    "nc_type nc_value", NULL },
+  { ZIK_API_AUDIO_NOISE_CONTROL_PATH, ZIK3_ONLY,
+    "<audio><noise_control type=\"{nc_type}\" value=\"{nc_value}\" "
+    "auto_nc=\"{auto_nc}\"/></audio>", "nc_type nc_value", NULL },
+  { ZIK_API_AUDIO_NOISE_CONTROL_AUTO_NC_PATH, ZIK3_ONLY, NULL, "auto_nc",
+    NULL },
+  { ZIK_API_AUDIO_NOISE_CONTROL_PHONE_MODE_PATH, ALL_MODELS,
+    "<audio><noise_control phone_mode=\"{phone_mode}\"/></audio>",
+    "phone_mode", NULL },
+  { "/api/audio/noise_cancellation/enabled", ALL_MODELS,
+    "<audio><noise_cancellation enabled=\"{noise_cancellation}\"/></audio>",
+    "noise_cancellation", NULL },
+  { ZIK_API_AUDIO_THUMB_EQUALIZER_VALUE_PATH, ALL_MODELS,
+    "<audio><thumb_equalizer value=\"{thumb_equalizer}\"/></audio>",
+    "thumb_equalizer", NULL },
+  { ZIK_API_AUDIO_EQUALIZER_ENABLED_PATH, ALL_MODELS,
+    "<audio><equalizer enabled=\"{equalizer}\"/></audio>", "equalizer",
+    NULL },
+  { "/api/audio/equalizer/preset_id", ALL_MODELS, NULL, "preset_id", NULL },
+  { "/api/audio/equalizer/preset_value", ALL_MODELS, NULL, "preset_value",
+    NULL },
+  { "/api/audio/param_equalizer/value", ALL_MODELS, NULL,
+    "param_equalizer", NULL },
+  { ZIK_API_AUDIO_SMART_AUDIO_TUNE_PATH, ALL_MODELS,
+    "<audio><smart_audio_tune enabled=\"{smart_audio_tune}\"/></audio>",
+    "smart_audio_tune", NULL },
+  { ZIK_API_AUDIO_PRESET_BYPASS_PATH, ALL_MODELS,
+    "<audio><preset bypass=\"{preset_bypass}\"/></audio>", "preset_bypass",
+    NULL },
+  { "/api/audio/preset/counter", ALL_MODELS,
+    "<audio><preset counter=\"{preset_counter}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_PRESET_CURRENT_PATH, ALL_MODELS,
+    "<audio><preset id=\"{preset_id}\"/></audio>", NULL, NULL },
+  /* download, activate, save, remove, clear_all and cancel_producer */
+  { "/api/audio/preset", ALL_MODELS, NULL, NULL, NULL },
+  { "/api/audio/preset/synchro", ALL_MODELS, NULL, NULL, NULL },
+  { ZIK_API_AUDIO_SOUND_EFFECT_PATH, ZIK2_ONLY,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_SOUND_EFFECT_PATH, ZIK3_ONLY,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\" mode=\"{se_mode}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_SOUND_EFFECT_ENABLED_PATH, ALL_MODELS,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\"/></audio>", "se_enabled", NULL },
+  { ZIK_API_AUDIO_SOUND_EFFECT_ANGLE_PATH, ALL_MODELS,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\"/></audio>", "se_angle", NULL },
+  { ZIK_API_AUDIO_SOUND_EFFECT_ROOM_SIZE_PATH, ALL_MODELS,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\"/></audio>", "se_room", NULL },
+  { "/api/audio/sound_effect/mode", ZIK3_ONLY,
+    "<audio><sound_effect enabled=\"{se_enabled}\" room_size=\"{se_room}\" "
+    "angle=\"{se_angle}\" mode=\"{se_mode}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_NOISE_PATH, ALL_MODELS,
+    "<audio><noise value=\"{noise}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_SOURCE_PATH, ALL_MODELS,
+    "<audio><source type=\"{source}\"/></audio>", NULL, NULL },
+  { ZIK_API_AUDIO_VOLUME_PATH, ALL_MODELS,
+    "<audio><volume value=\"{volume}\"/></audio>", NULL, NULL },
+  { "/api/audio/specific_mode/enabled", ALL_MODELS,
+    "<audio><specific_mode enabled=\"{specific_mode}\"/></audio>",
+    "specific_mode", NULL },
+  { "/api/audio/delay", ZIK3_ONLY,
+    "<audio><delay value=\"{delay}\"/></audio>", "delay", NULL },
+
+  /* bluetooth */
+  { ZIK_API_BLUETOOTH_FRIENDLY_NAME_PATH, ALL_MODELS,
+    "<bluetooth friendlyname=\"{friendlyname}\"/>", "friendlyname", NULL },
+
+  /* flight mode */
+  { ZIK_API_FLIGHT_MODE_PATH, ALL_MODELS,
+    "<flight_mode enabled=\"{flight_mode}\"/>", NULL, "flight_mode" },
+
+  /* software */
+  { ZIK_API_SOFTWARE_VERSION_PATH, ALL_MODELS,
+    "<software sip6=\"{version}\" pic=\"{pic}\" tts=\"{tts}\"/>", NULL,
+    NULL },
+  { "/api/software/version_checking", ALL_MODELS,
+    "<software version_checking=\"{version_checking}\"/>", NULL, NULL },
+  { "/api/software/download_size", ALL_MODELS, NULL, "download_size", NULL },
+  { "/api/software/download_check_state", ALL_MODELS,
+    "<software download_check_state=\"{download_check_state}\"/>", NULL,
+    NULL },
+  { ZIK_API_SOFTWARE_TTS_PATH, ALL_MODELS, "<tts enabled=\"{tts}\"/>", NULL,
+    "tts" },
+
+  /* system */
+  { ZIK_API_SYSTEM_BATTERY_FORECAST_PATH, ALL_MODELS,
+    "<system><battery_forecast value=\"{battery_forecast}\"/></system>", NULL,
+    NULL },
+  { ZIK_API_SYSTEM_BATTERY_PATH, ALL_MODELS,
+    "<system><battery state=\"{battery_state}\" "
+    "percent=\"{battery_percent}\" timeleft=\"\"/></system>", NULL, NULL },
+  { ZIK_API_SYSTEM_AUTO_CONNECTION_ENABLED_PATH, ALL_MODELS,
+    "<system><auto_connection enabled=\"{auto_connection}\"/></system>",
+    "auto_connection", NULL },
+  /* factory_reset and calibrate */
+  { "/api/system", ALL_MODELS, NULL, NULL, NULL },
+  { ZIK_API_SYSTEM_ANC_PHONE_MODE_ENABLED_PATH, ALL_MODELS,
+    "<system><anc_phone_mode enabled=\"{anc_phone_mode}\"/></system>",
+    "anc_phone_mode", NULL },
+  { ZIK_API_SYSTEM_DEVICE_TYPE_PATH, ALL_MODELS,
+    "<system><device_type value=\"{device_type}\"/></system>", NULL, NULL },
+  { ZIK_API_SYSTEM_COLOR_PATH, ALL_MODELS,
+    "<system><color value=\"{color}\"/></system>", NULL, NULL },
+  { ZIK_API_SYSTEM_PI_PATH, ALL_MODELS, "<system pi=\"{pi}\"/>", NULL, NULL },
+  { "/api/system/auto_power_off/presets_list", ALL_MODELS,
+    "<system><auto_power_off presets=\"0,5,10,15,30,60\"/></system>", NULL,
+    NULL },
+  { ZIK_API_SYSTEM_AUTO_POWER_OFF_PATH, ALL_MODELS,
+    "<system><auto_power_off value=\"{auto_power_off}\"/></system>",
+    "auto_power_off", NULL },
+  { ZIK_API_SYSTEM_HEAD_DETECTION_ENABLED_PATH, ALL_MODELS,
+    "<system><head_detection enabled=\"{head_detection}\"/></system>",
+    "head_detection", NULL },
+  { "/api/system/bt_address", ALL_MODELS,
+    "<system bt_address=\"{bt_address}\"/>", NULL, NULL },
+
+  /* sports, start, stop, resume, pause and status */
+  { "/api/sports", ZIK3_ONLY, NULL, NULL, NULL },
+  { "/api/sports/calibration", ZIK3_ONLY, NULL, NULL, NULL },
+  { "/api/sports/set", ZIK3_ONLY, NULL, "biodata", NULL },
+  { "/api/sports/sync", ZIK3_ONLY, NULL, NULL, NULL },
+  { "/api/sports/fitness/type", ZIK3_ONLY, NULL, "fitness_type", NULL },
+  { "/api/sports/podometer/date", ZIK3_ONLY, NULL, "podometer_date", NULL },
+};
+
+/* initial state: key, Zik2 value, Zik3 value */
+static const gchar *state_defaults[][3] = {
+  { "username", "", "" },
+  { "appli_version", "", "" },
+  { "playing", "false", "false" },
+  { "title", "", "" },
+  { "artist", "", "" },
+  { "album", "", "" },
+  { "genre", "", "" },
+  { "nc_enabled", "true", "true" },
+  { "nc_type", "anc", "anc" },
+  { "nc_value", "1", "1" },
+  { "auto_nc", "false", "false" },
+  { "phone_mode", "anc", "anc" },
+  { "noise_cancellation", "true", "true" },
+  { "thumb_equalizer", "0", "0" },
+  { "equalizer", "false", "false" },
+  { "preset_id", "0", "0" },
+  { "preset_value", "", "" },
+  { "param_equalizer", "", "" },
+  { "smart_audio_tune", "false", "false" },
+  { "preset_bypass", "true", "true" },
+  { "preset_counter", "0", "0" },
+  { "se_enabled", "false", "false" },
+  { "se_room", "concert", "concert" },
+  { "se_angle", "120", "120" },
+  { "se_mode", "headphones", "headphones" },
+  { "noise", "-1", "-1" },
+  { "source", "a2dp", "a2dp" },
+  { "volume", "350", "350" },
+  { "specific_mode", "false", "false" },
+  { "delay", "0", "0" },
+  { "friendlyname", "Parrot Zik 2.0", "Parrot ZIK 3" },
+  { "flight_mode", "false", "false" },
+  { "version", "2.05", "3.02" },
+  { "pic", "35", "35" },
+  { "version_checking", "false", "false" },
+  { "download_size", "0", "0" },
+  { "download_check_state", "0", "0" },
+  { "tts", "true", "true" },
+  { "battery_forecast", "-1", "-1" },
+  { "battery_state", "in_use", "in_use" },
+  { "battery_percent", "80", "80" },
+  { "auto_connection", "true", "true" },
+  { "anc_phone_mode", "false", "false" },
+  { "device_type", "2", "3" },
+  { "color", "1", "1" },
+  { "pi", "PI000000000000000", "PI000000000000000" },
+  { "auto_power_off", "0", "0" },
+  { "head_detection", "true", "true" },
+  { "bt_address", "00:00:00:00:00:00", "00:00:00:00:00:00" },
+  { "biodata", "", "" },
+  { "fitness_type", "", "" },
+  { "podometer_date", "", "" },
+};
+
+struct _ZikEmulator
+{
+  gint ref_count;
+
+  ZikEmulatorModel model;
+  ZikEmulatorQuirks quirks;
+  gboolean session;
+
+  /* key => value, both owned */
+  GHashTable *state;
+
+  /* serving */
+  ZikTransport *transport;
+  GMainContext *context;
+  GSource *in_source;
+  GSource *out_source;
+  ZikMessageDecoder *decoder;
+  GByteArray *out_buffer;
+
+  ZikEmulatorClosedFunc closed_func;
+  gpointer closed_userdata;
+};
+
+static void zik_emulator_detach (ZikEmulator * emu);
+
+ZikEmulator *
+zik_emulator_new (ZikEmulatorModel model)
+{
+  ZikEmulator *emu;
+  guint column;
+  guint i;
+
+  g_return_val_if_fail (model == ZIK_EMULATOR_MODEL_ZIK2 ||
+      model == ZIK_EMULATOR_MODEL_ZIK3, NULL);
+
+  emu = g_slice_new0 (ZikEmulator);
+  emu->ref_count = 1;
+  emu->model = model;
+  emu->state = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  column = model == ZIK_EMULATOR_MODEL_ZIK2 ? 1 : 2;
+  for (i = 0; i < G_N_ELEMENTS (state_defaults); i++)
+    g_hash_table_insert (emu->state, g_strdup (state_defaults[i][0]),
+        g_strdup (state_defaults[i][column]));
+
+  return emu;
+}
+
+ZikEmulator *
+zik_emulator_ref (ZikEmulator * emu)
+{
+  g_atomic_int_inc (&emu->ref_count);
+  return emu;
+}
+
+void
+zik_emulator_unref (ZikEmulator * emu)
+{
+  if (g_atomic_int_dec_and_test (&emu->ref_count)) {
+    zik_emulator_detach (emu);
+    g_hash_table_unref (emu->state);
+    g_slice_free (ZikEmulator, emu);
+  }
+}
+
+void
+zik_emulator_set_quirks (ZikEmulator * emu, ZikEmulatorQuirks quirks)
+{
+  emu->quirks = quirks;
+}
+
+/* Return: (transfer none): value of @key, NULL if unknown */
+const gchar *
+zik_emulator_get_state (ZikEmulator * emu, const gchar * key)
+{
+  return g_hash_table_lookup (emu->state, key);
+}
+
+/* change state, as user would do on device itself (ie change volume) */
+void
+zik_emulator_set_state (ZikEmulator * emu, const gchar * key,
+    const gchar * value)
+{
+  g_hash_table_insert (emu->state, g_strdup (key), g_strdup (value));
+}
+
+static const ZikEmulatorApi *
+zik_emulator_lookup_api (ZikEmulator * emu, const gchar * path, gsize len)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (api_table); i++) {
+    const ZikEmulatorApi *api = &api_table[i];
+
+    if ((api->models & emu->model) && strlen (api->path) == len &&
+        memcmp (api->path, path, len) == 0)
+      return api;
+  }
+
+  return NULL;
+}
+
+/* append @tmpl to @str with {key} replaced by escaped state value */
+static void
+zik_emulator_expand (ZikEmulator * emu, GString * str, const gchar * tmpl)
+{
+  const gchar *p = tmpl;
+
+  while (*p) {
+    const gchar *start = strchr (p, '{');
+    const gchar *end;
+    gchar *key;
+    gchar *value;
+
+    if (start == NULL) {
+      g_string_append (str, p);
+      return;
+    }
+
+    g_string_append_len (str, p, start - p);
+
+    end = strchr (start, '}');
+    g_assert (end != NULL);
+
+    key = g_strndup (start + 1, end - start - 1);
+    value = g_markup_escape_text (zik_emulator_get_state (emu, key), -1);
+    g_string_append (str, value);
+    g_free (value);
+    g_free (key);
+
+    p = end + 1;
+  }
+}
+
+/* store set arguments: "value&name=value&name=value..." */
+static void
+zik_emulator_apply_set (ZikEmulator * emu, const gchar * keys_str,
+    const gchar * args, gsize args_len)
+{
+  gchar **keys;
+  gchar **values;
+  gchar *args_str;
+  guint i;
+
+  keys = g_strsplit (keys_str, " ", -1);
+  args_str = g_strndup (args, args_len);
+  values = g_strsplit (args_str, "&", -1);
+
+  for (i = 0; keys[i] != NULL && values[i] != NULL; i++) {
+    const gchar *value = values[i];
+
+    if (i > 0 && strchr (value, '='))
+      value = strchr (value, '=') + 1;
+
+    zik_emulator_set_state (emu, keys[i], value);
+  }
+
+  g_strfreev (values);
+  g_free (args_str);
+  g_strfreev (keys);
+}
+
+static ZikMessage *
+zik_emulator_handle_request (ZikEmulator * emu, ZikMessage * msg)
+{
+  const ZikEmulatorApi *api;
+  const gchar *path;
+  const gchar *method;
+  const gchar *args;
+  gsize path_len;
+  gsize args_len = 0;
+  gsize answer_path_len;
+  gsize method_len;
+  GString *xml;
+  ZikMessage *answer;
+
+  path = zik_message_peek_request_path (msg, &path_len);
+  if (path == NULL) {
+    g_warning ("ZikEmulator %p: malformed request", emu);
+    return NULL;
+  }
+
+  args = zik_message_peek_request_args (msg, &args_len);
+
+  /* last component of path is the method */
+  method = g_strrstr_len (path, path_len, "/");
+  if (method == NULL) {
+    g_warning ("ZikEmulator %p: no method in request", emu);
+    return NULL;
+  }
+  method_len = path + path_len - method - 1;
+  method++;
+
+  api = zik_emulator_lookup_api (emu, path, method - 1 - path);
+  if (api == NULL && (emu->quirks & ZIK_EMULATOR_QUIRK_DROP_UNKNOWN))
+    return NULL;
+
+  answer_path_len = path_len;
+  if (emu->quirks & ZIK_EMULATOR_QUIRK_SHORT_ANSWER_PATH)
+    answer_path_len = method - 1 - path;
+
+  xml = g_string_new (XML_HEADER);
+  g_string_append (xml, "<answer path=\"");
+  g_string_append_len (xml, path, answer_path_len);
+  g_string_append (xml, "\"");
+
+#define METHOD_IS(name) \
+  (method_len == strlen (name) && memcmp (method, name, method_len) == 0)
+
+  if (api == NULL) {
+    g_string_append (xml, " error=\"true\"/>");
+  } else if (METHOD_IS ("get") && api->get) {
+    g_string_append (xml, ">");
+    zik_emulator_expand (emu, xml, api->get);
+    g_string_append (xml, "</answer>");
+  } else {
+    if (METHOD_IS ("set") && api->set && args)
+      zik_emulator_apply_set (emu, api->set, args, args_len);
+    else if (METHOD_IS ("enable") && api->toggle)
+      zik_emulator_set_state (emu, api->toggle, "true");
+    else if (METHOD_IS ("disable") && api->toggle)
+      zik_emulator_set_state (emu, api->toggle, "false");
+
+    /* other methods are actions, nothing to emulate */
+    g_string_append (xml, "/>");
+  }
+
+#undef METHOD_IS
+
+  answer = zik_message_new_request_reply (xml->str, xml->len);
+  g_string_free (xml, TRUE);
+
+  return answer;
+}
+
+/* Return: (transfer full): the answer to @msg, NULL if there is none */
+ZikMessage *
+zik_emulator_handle_message (ZikEmulator * emu, ZikMessage * msg)
+{
+  if (zik_message_is_open_session (msg)) {
+    emu->session = TRUE;
+    return zik_message_new_acknowledge ();
+  } else if (zik_message_is_close_session (msg)) {
+    emu->session = FALSE;
+    return zik_message_new_acknowledge ();
+  } else if (zik_message_is_request (msg)) {
+    if (!emu->session)
+      g_warning ("ZikEmulator %p: request outside of session", emu);
+
+    return zik_emulator_handle_request (emu, msg);
+  }
+
+  g_warning ("ZikEmulator %p: unexpected message", emu);
+  return NULL;
+}
+
+/** serving a transport */
+
+static void
+zik_emulator_detach (ZikEmulator * emu)
+{
+  if (emu->in_source) {
+    g_source_destroy (emu->in_source);
+    g_source_unref (emu->in_source);
+    emu->in_source = NULL;
+  }
+
+  if (emu->out_source) {
+    g_source_destroy (emu->out_source);
+    g_source_unref (emu->out_source);
+    emu->out_source = NULL;
+  }
+
+  if (emu->transport) {
+    zik_transport_unref (emu->transport);
+    emu->transport = NULL;
+  }
+
+  if (emu->context) {
+    g_main_context_unref (emu->context);
+    emu->context = NULL;
+  }
+
+  if (emu->decoder) {
+    zik_message_decoder_free (emu->decoder);
+    emu->decoder = NULL;
+  }
+
+  if (emu->out_buffer) {
+    g_byte_array_unref (emu->out_buffer);
+    emu->out_buffer = NULL;
+  }
+
+  emu->session = FALSE;
+}
+
+/* remote side is gone */
+static void
+zik_emulator_close (ZikEmulator * emu)
+{
+  zik_emulator_detach (emu);
+
+  if (emu->closed_func)
+    emu->closed_func (emu, emu->closed_userdata);
+}
+
+static gboolean zik_emulator_on_output (ZikTransport * transport,
+    GIOCondition condition, gpointer userdata);
+
+/* send as much of pending answers as possible, return FALSE if closed */
+static gboolean
+zik_emulator_flush (ZikEmulator * emu)
+{
+  GOutputVector vector;
+  GError *error = NULL;
+  gssize sbytes;
+
+  if (emu->out_source || emu->out_buffer->len == 0)
+    return TRUE;
+
+  vector.buffer = emu->out_buffer->data;
+  vector.size = emu->out_buffer->len;
+
+  sbytes = zik_transport_send (emu->transport, &vector, 1, &error);
+  if (sbytes < 0) {
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_warning ("ZikEmulator %p: failed to send: %s", emu, error->message);
+      g_error_free (error);
+      zik_emulator_close (emu);
+      return FALSE;
+    }
+
+    g_error_free (error);
+    sbytes = 0;
+  }
+
+  g_byte_array_remove_range (emu->out_buffer, 0, sbytes);
+
+  if (emu->out_buffer->len > 0) {
+    emu->out_source = zik_transport_create_watch (emu->transport, G_IO_OUT,
+        zik_emulator_on_output, emu, NULL);
+    g_source_attach (emu->out_source, emu->context);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+zik_emulator_on_output (ZikTransport * transport, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikEmulator *emu = (ZikEmulator *) userdata;
+
+  g_source_unref (emu->out_source);
+  emu->out_source = NULL;
+
+  zik_emulator_flush (emu);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+zik_emulator_on_input (ZikTransport * transport, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikEmulator *emu = (ZikEmulator *) userdata;
+  ZikMessage *msg;
+  GError *error = NULL;
+  guint8 *buffer;
+  gsize size;
+  gssize rbytes;
+
+  buffer = zik_message_decoder_get_buffer (emu->decoder, &size);
+  rbytes = zik_transport_receive (emu->transport, buffer, size, &error);
+  if (rbytes < 0) {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_error_free (error);
+      return G_SOURCE_CONTINUE;
+    }
+
+    g_warning ("ZikEmulator %p: failed to receive: %s", emu, error->message);
+    g_error_free (error);
+    goto closed;
+  } else if (rbytes == 0) {
+    goto closed;
+  }
+
+  zik_message_decoder_commit (emu->decoder, rbytes);
+
+  while ((msg = zik_message_decoder_pop (emu->decoder, &error))) {
+    ZikMessage *answer;
+
+    answer = zik_emulator_handle_message (emu, msg);
+    zik_message_free (msg);
+
+    if (answer) {
+      guint8 *data;
+      gsize data_size;
+
+      data = zik_message_make_buffer (answer, &data_size);
+      g_byte_array_append (emu->out_buffer, data, data_size);
+      g_free (data);
+      zik_message_free (answer);
+    }
+  }
+
+  if (error) {
+    g_warning ("ZikEmulator %p: %s", emu, error->message);
+    g_error_free (error);
+    goto closed;
+  }
+
+  if (!zik_emulator_flush (emu))
+    return G_SOURCE_REMOVE;
+
+  return G_SOURCE_CONTINUE;
+
+closed:
+  /* source is destroyed with detach, main context keeps it alive until we
+   * return */
+  zik_emulator_close (emu);
+  return G_SOURCE_REMOVE;
+}
+
+/* Answer messages received on @transport from @context, until remote closes
+ * it. @closed_func is then called, the emulator being ready to serve another
+ * transport */
+void
+zik_emulator_serve (ZikEmulator * emu, ZikTransport * transport,
+    GMainContext * context, ZikEmulatorClosedFunc closed_func,
+    gpointer userdata)
+{
+  zik_emulator_detach (emu);
+
+  emu->transport = zik_transport_ref (transport);
+  if (context)
+    emu->context = g_main_context_ref (context);
+  else
+    emu->context = g_main_context_ref_thread_default ();
+  emu->decoder = zik_message_decoder_new ();
+  emu->out_buffer = g_byte_array_new ();
+  emu->closed_func = closed_func;
+  emu->closed_userdata = userdata;
+
+  emu->in_source = zik_transport_create_watch (transport,
+      G_IO_IN | G_IO_HUP | G_IO_ERR, zik_emulator_on_input, emu, NULL);
+  g_source_attach (emu->in_source, emu->context);
+}
+
+/* Return: (transfer full): a connection to @emu, through a socketpair served
+ * from @context */
+ZikConnection *
+zik_emulator_connect (ZikEmulator * emu, GMainContext * context)
+{
+  ZikTransport *transport;
+  ZikTransport *peer;
+  ZikConnection *conn;
+
+  if (!zik_transport_new_socketpair (&transport, &peer))
+    return NULL;
+
+  zik_emulator_serve (emu, peer, context, NULL, NULL);
+  conn = zik_connection_new_for_transport (transport, context);
+
+  zik_transport_unref (peer);
+  zik_transport_unref (transport);
+
+  return conn;
+}
@@ -0,0 +1,68 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIK_EMULATOR_H
+#define ZIK_EMULATOR_H
+
+#include <glib.h>
+
+#include "zikmessage.h"
+#include "ziktransport.h"
+#include "zikconnection.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ZikEmulator ZikEmulator;
+
+typedef enum
+{
+  ZIK_EMULATOR_MODEL_ZIK2 = (1 << 0),
+  ZIK_EMULATOR_MODEL_ZIK3 = (1 << 1)
+} ZikEmulatorModel;
+
+/* firmware misbehaviours which can be reproduced */
+typedef enum
+{
+  ZIK_EMULATOR_QUIRK_NONE = 0,
+  /* <answer> path lacks the method, ie "/api/audio/volume" */
+  ZIK_EMULATOR_QUIRK_SHORT_ANSWER_PATH = (1 << 0),
+  /* requests on unknown path are never answered */
+  ZIK_EMULATOR_QUIRK_DROP_UNKNOWN = (1 << 1)
+} ZikEmulatorQuirks;
+
+typedef void (*ZikEmulatorClosedFunc) (ZikEmulator * emu, gpointer userdata);
+
+ZikEmulator *zik_emulator_new (ZikEmulatorModel model);
+ZikEmulator *zik_emulator_ref (ZikEmulator * emu);
+void zik_emulator_unref (ZikEmulator * emu);
+
+void zik_emulator_set_quirks (ZikEmulator * emu, ZikEmulatorQuirks quirks);
+const gchar *zik_emulator_get_state (ZikEmulator * emu, const gchar * key);
+void zik_emulator_set_state (ZikEmulator * emu, const gchar * key,
+    const gchar * value);
+
+ZikMessage *zik_emulator_handle_message (ZikEmulator * emu, ZikMessage * msg);
+
+void zik_emulator_serve (ZikEmulator * emu, ZikTransport * transport,
+    GMainContext * context, ZikEmulatorClosedFunc closed_func,
+    gpointer userdata);
+ZikConnection *zik_emulator_connect (ZikEmulator * emu,
+    GMainContext * context);
+
+G_END_DECLS
+
+#endif
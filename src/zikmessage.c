@@ -18,10 +18,16 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <gio/gio.h>
+
 #include "zikmessage.h"
 #include "zikinfo.h"
+#include "zikapi.h"
+#include "zikscan.h"
 
-#define ZIK_MESSAGE_HEADER_LEN 3
+/* message size is stored to an uint16_t, decoder slab can hold two full
+ * messages so that a large read always fits behind a partial one */
+#define ZIK_MESSAGE_SLAB_SIZE (2 * G_MAXUINT16)
 
 typedef enum
 {
@@ -37,401 +43,550 @@ struct _ZikMessage
 
   gchar *payload;
   gsize payload_size;
+
+  /* payload points in slab of decoder if not NULL, link being in its
+   * messages, see zik_message_decoder_pop () */
+  ZikMessageDecoder *decoder;
+  GList link;
+
+  /* header followed by payload of prebuilt requests, which are never
+   * freed, see zik_message_new_request () */
+  const guint8 *frame;
 };
 
-struct _ZikRequestReplyData
+/* requests built once for each API path, which are the most frequent ones */
+typedef enum
+{
+  ZIK_REQUEST_FRAME_GET,
+  ZIK_REQUEST_FRAME_ENABLE,
+  ZIK_REQUEST_FRAME_DISABLE,
+  ZIK_REQUEST_FRAME_SET_TRUE,
+  ZIK_REQUEST_FRAME_SET_FALSE,
+
+  ZIK_N_REQUEST_FRAMES
+} ZikRequestFrame;
+
+static const struct
 {
-  GNode *root;
+  const gchar *method;
+  const gchar *args;
+} zik_request_frame_specs[ZIK_N_REQUEST_FRAMES] = {
+  [ZIK_REQUEST_FRAME_GET] = { "get", NULL },
+  [ZIK_REQUEST_FRAME_ENABLE] = { "enable", NULL },
+  [ZIK_REQUEST_FRAME_DISABLE] = { "disable", NULL },
+  [ZIK_REQUEST_FRAME_SET_TRUE] = { "set", "true" },
+  [ZIK_REQUEST_FRAME_SET_FALSE] = { "set", "false" },
+};
+
+/* indexed by ZikApiPathId */
+static ZikMessage zik_request_frames[ZIK_N_API_PATHS][ZIK_N_REQUEST_FRAMES];
+
+struct _ZikMessageDecoder
+{
+  guint8 *slab;
+  gsize start;
+  gsize end;
+
+  /* popped messages pointing in slab */
+  GQueue messages;
 };
 
 /* MessageReply XML parsing */
+
+/* nesting of answer elements, deeper ones are rejected */
+#define ZIK_PARSER_MAX_DEPTH 16
+
+/* replies are allocated from chunks freed at once, the reply itself being
+ * at the start of the first one so that most of them are a single block */
+#define ZIK_REPLY_CHUNK_SIZE 2048
+#define ZIK_REPLY_ALIGN 8
+#define ZIK_REPLY_ALIGN_SIZE(size) \
+  (((size) + ZIK_REPLY_ALIGN - 1) & ~((gsize) ZIK_REPLY_ALIGN - 1))
+
+typedef struct _ZikReplyChunk ZikReplyChunk;
+typedef struct _ZikReplyNode ZikReplyNode;
+
+struct _ZikReplyChunk
+{
+  ZikReplyChunk *next;
+  gsize size;
+  gsize used;
+  guint8 data[];
+};
+
+/* info of a node directly follows it */
+struct _ZikReplyNode
+{
+  gpointer info;
+  ZikReplyNode *parent;
+  /* next node of the same element */
+  ZikReplyNode *next_same;
+  /* set once info is stolen, reply it keeps alive */
+  ZikRequestReplyData *reply;
+};
+
+struct _ZikRequestReplyData
+{
+  /* current chunk first */
+  ZikReplyChunk *chunks;
+  ZikReplyNode *root;
+  /* one for the caller, one per stolen info not released yet */
+  gint ref_count;
+
+  /* nodes of each element in document order, chained by next_same */
+  ZikReplyNode *first[ZIK_N_ELEMENTS];
+  ZikReplyNode *last[ZIK_N_ELEMENTS];
+};
+
+typedef union
+{
+  const gchar *string;
+  gboolean boolean;
+  gint integer;
+} ZikAttrValue;
+
 typedef struct
 {
-  GNode *root;
-  GNode *parent;
+  ZikRequestReplyData *reply;
+  ZikReplyNode *parent;
+
+  /* ids of open elements, unknown ones included */
+  ZikElementId stack[ZIK_PARSER_MAX_DEPTH];
+  guint depth;
+
+  /* targeted mode: no tree is built, only the first element matching target
+   * is, into info, and parsing finishes at its end */
+  const ZikElementSpec *target;
+  gpointer info;
+  guint info_depth;
+  gboolean error;
 
   gboolean finished;
 } ParserData;
 
-static void
-zik2_xml_parser_start_element (GMarkupParseContext * context,
-    const gchar * element_name, const gchar ** attribute_names,
-    const gchar ** attribute_values, gpointer userdata, GError ** error)
+static ZikReplyChunk *
+zik_reply_chunk_new (gsize size)
 {
-  ParserData *data = (ParserData *) userdata;
-  GSList *stack;
+  ZikReplyChunk *chunk;
 
-  stack = (GSList *) g_markup_parse_context_get_element_stack (context);
+  chunk = g_malloc (sizeof (ZikReplyChunk) + size);
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
 
-  if (data->finished)
-    return;
+  return chunk;
+}
 
-  if (g_strcmp0 (element_name, "answer") == 0) {
-    gchar *path;
-    gboolean err;
+static ZikRequestReplyData *
+zik_request_reply_data_new (void)
+{
+  ZikReplyChunk *chunk;
+  ZikRequestReplyData *reply;
 
-    if (g_slist_length (stack) > 1) {
-      /* answer shall be first */
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<answer> elements can only be top-level element");
-      return;
-    }
+  chunk = zik_reply_chunk_new (ZIK_REPLY_CHUNK_SIZE);
+  reply = (ZikRequestReplyData *) chunk->data;
+  chunk->used = ZIK_REPLY_ALIGN_SIZE (sizeof (*reply));
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "path", &path,
-          G_MARKUP_COLLECT_BOOLEAN | G_MARKUP_COLLECT_OPTIONAL, "error", &err,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->root = g_node_new (zik_answer_info_new (path, err));
-    data->parent = data->root;
-  } else if (g_strcmp0 (element_name, "audio") == 0) {
-    if (g_slist_length (stack) < 2) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<audio> element should be embedded in <answer>");
-      return;
-    }
+  memset (reply, 0, sizeof (*reply));
+  reply->chunks = chunk;
+  reply->ref_count = 1;
 
-    /* no attribute to collect, yet */
-    data->parent = g_node_append_data (data->parent, zik_audio_info_new ());
-  } else if (g_strcmp0 (element_name, "software") == 0) {
-    gchar *sip6, *pic, *tts;
+  return reply;
+}
 
-    if (g_slist_length (stack) < 2) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<software> element should be embedded in <answer>");
-      return;
-    }
+/* Return: zero-filled memory living as long as @reply */
+static gpointer
+zik_reply_alloc (ZikRequestReplyData * reply, gsize size)
+{
+  ZikReplyChunk *chunk = reply->chunks;
+  gpointer mem;
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "sip6", &sip6,
-          G_MARKUP_COLLECT_STRING, "pic", &pic,
-          G_MARKUP_COLLECT_STRING, "tts", &tts,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_software_info_new (sip6, pic, tts));
-  } else if (g_strcmp0 (element_name, "system") == 0) {
-    gchar *pi;
-
-    if (g_slist_length (stack) < 2) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<system> element should be embedded in <answer>");
-      return;
-    }
+  size = ZIK_REPLY_ALIGN_SIZE (size);
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_STRING | G_MARKUP_COLLECT_OPTIONAL, "pi", &pi,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent, zik_system_info_new (pi));
-  } else if (g_strcmp0 (element_name, "noise_control") == 0) {
-    gboolean enabled;
-    gchar *type;
-    gchar *valstr;
-    guint value = 0;
-    gboolean auto_nc;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<noise_control> element should be embedded in <audio>");
-      return;
-    }
+  if (chunk->size - chunk->used < size) {
+    chunk = zik_reply_chunk_new (MAX (size, ZIK_REPLY_CHUNK_SIZE));
+    chunk->next = reply->chunks;
+    reply->chunks = chunk;
+  }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN | G_MARKUP_COLLECT_OPTIONAL, "enabled", &enabled,
-          G_MARKUP_COLLECT_STRING | G_MARKUP_COLLECT_OPTIONAL, "type", &type,
-          G_MARKUP_COLLECT_STRING | G_MARKUP_COLLECT_OPTIONAL, "value", &valstr,
-          G_MARKUP_COLLECT_BOOLEAN | G_MARKUP_COLLECT_OPTIONAL, "auto_nc", &auto_nc,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    if (valstr)
-      value = atoi (valstr);
-
-    data->parent = g_node_append_data (data->parent,
-        zik_noise_control_info_new (enabled, type, value, auto_nc));
-  } else if (g_strcmp0 (element_name, "source") == 0) {
-    gchar *type;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<source> element should be embedded in <audio>");
-      return;
-    }
+  mem = chunk->data + chunk->used;
+  chunk->used += size;
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "type", &type,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_source_info_new (type));
-  } else if (g_strcmp0 (element_name, "battery") == 0) {
-    gchar *state;
-    gchar *percent_str;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "system")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<battery> element should be embedded in <system>");
-      return;
-    }
+  memset (mem, 0, size);
+  return mem;
+}
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "state", &state,
-          G_MARKUP_COLLECT_STRING, "percent", &percent_str,
-          G_MARKUP_COLLECT_STRING, "timeleft", NULL,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_battery_info_new (state, atoi (percent_str)));
-  } else if (g_strcmp0 (element_name, "volume") == 0) {
-    gchar *value;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<volume> element should be embedded in <audio>");
-      return;
-    }
+static gchar *
+zik_reply_strdup (ZikRequestReplyData * reply, const gchar * str)
+{
+  gsize size;
+  gchar *copy;
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "value", &value,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_volume_info_new (atoi (value)));
-  } else if (g_strcmp0 (element_name, "head_detection") == 0) {
-    gboolean enabled;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "system")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<head_detection> element should be embedded in <system>");
-      return;
-    }
+  if (str == NULL)
+    return NULL;
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_head_detection_info_new (enabled));
-  } else if (g_strcmp0 (element_name, "color") == 0) {
-    gchar *value;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "system")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<color> element should be embedded in <system>");
-      return;
-    }
+  size = strlen (str) + 1;
+  copy = zik_reply_alloc (reply, size);
+  memcpy (copy, str, size);
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "value", &value,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_color_info_new (atoi (value)));
-  } else if (g_strcmp0 (element_name, "flight_mode") == 0) {
-    gboolean value;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "answer")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<flight_mode> element should be embedded in <answer>");
-      return;
-    }
+  return copy;
+}
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_BOOLEAN, "enabled", &value,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_flight_mode_info_new (value));
-  } else if (g_strcmp0 (element_name, "bluetooth") == 0) {
-    const gchar *value;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "answer")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<bluetooth> element should be embedded in <answer>");
-      return;
+/* Fill zeroed @info, strings being allocated from @reply. If NULL, they are
+ * left as is, @info being a standalone one which already has them */
+static void
+zik_element_init_info (const ZikElementSpec * spec,
+    const ZikAttrValue * values, ZikInfoHeader * info,
+    ZikRequestReplyData * reply)
+{
+  guint i;
+
+  info->itype = spec->get_type ();
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    const ZikAttrSpec *attr = &spec->attrs[i];
+    guint8 *field = (guint8 *) info + attr->offset;
+
+    switch (attr->type) {
+      case ZIK_ATTR_STRING:
+        if (reply)
+          *(gchar **) field = zik_reply_strdup (reply, values[i].string);
+        break;
+      case ZIK_ATTR_INTERNED:
+        if (reply)
+          *(const gchar **) field = zik_attr_intern (spec->id, i,
+              values[i].string);
+        break;
+      case ZIK_ATTR_BOOLEAN:
+        *(gboolean *) field = values[i].boolean;
+        break;
+      case ZIK_ATTR_INT:
+      case ZIK_ATTR_ENUM:
+        *(gint *) field = values[i].integer;
+        break;
+      case ZIK_ATTR_IGNORED:
+        break;
     }
+  }
+}
+
+static gboolean
+zik_attr_is_string (const ZikAttrSpec * attr)
+{
+  return attr->type == ZIK_ATTR_STRING || attr->type == ZIK_ATTR_INTERNED;
+}
+
+/* Return: standalone refcounted info */
+static gpointer
+zik_element_new_info (const ZikElementSpec * spec, const ZikAttrValue * values)
+{
+  const gchar *strings[ZIK_ATTR_MAX] = { NULL, };
+  ZikInfoHeader *info;
+  guint i;
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    if (zik_attr_is_string (&spec->attrs[i]))
+      strings[i] = values[i].string;
+  }
+
+  info = zik_info_new (spec->id, strings);
+  zik_element_init_info (spec, values, info, NULL);
+
+  return info;
+}
+
+/* Return: standalone copy of @src which may belong to a reply */
+static gpointer
+zik_element_copy_info (const ZikElementSpec * spec, gconstpointer src)
+{
+  const gchar *strings[ZIK_ATTR_MAX] = { NULL, };
+  ZikInfoHeader *info;
+  guint i;
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    if (zik_attr_is_string (&spec->attrs[i]))
+      strings[i] = *(const gchar **) ((const guint8 *) src +
+          spec->attrs[i].offset);
+  }
+
+  info = zik_info_new (spec->id, strings);
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    const ZikAttrSpec *attr = &spec->attrs[i];
+
+    if (attr->type == ZIK_ATTR_BOOLEAN || attr->type == ZIK_ATTR_INT ||
+        attr->type == ZIK_ATTR_ENUM)
+      memcpy ((guint8 *) info + attr->offset,
+          (const guint8 *) src + attr->offset, sizeof (gint));
+  }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error, G_MARKUP_COLLECT_STRING, "friendlyname",
-          &value, G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_bluetooth_info_new (value));
-  } else if (g_strcmp0 (element_name, "sound_effect") == 0) {
-    gboolean enabled;
-    const gchar *room_size;
-    const gchar *angle;
-    const gchar *mode;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<sound_effect> element should be embedded in <audio>");
-      return;
+  return info;
+}
+
+/* info types by element, g_type_get_qdata () would take GType lock on each
+ * lookup */
+static GType zik_element_types[ZIK_N_ELEMENTS];
+
+/* open addressing table of elements by info type, ZIK_ELEMENT_UNKNOWN for
+ * empty slots, kept at most half full so that probing is short */
+#define ZIK_ELEMENT_TYPES_BITS 6
+#define ZIK_ELEMENT_TYPES_SIZE (1 << ZIK_ELEMENT_TYPES_BITS)
+
+G_STATIC_ASSERT (ZIK_N_ELEMENTS * 2 <= ZIK_ELEMENT_TYPES_SIZE);
+
+static guint8 zik_element_types_table[ZIK_ELEMENT_TYPES_SIZE];
+
+static inline guint
+zik_element_types_hash (GType type)
+{
+  /* type nodes are aligned, low bits carry no information */
+  return ((guint32) (type >> 3) * 2654435769u) >>
+      (32 - ZIK_ELEMENT_TYPES_BITS);
+}
+
+static const ZikElementSpec *
+zik_element_spec_for_type (GType type)
+{
+  static gsize init = 0;
+  guint i;
+
+  if (g_once_init_enter (&init)) {
+    for (i = ZIK_ELEMENT_ANY + 1; i < ZIK_N_ELEMENTS; i++) {
+      guint h;
+
+      zik_element_types[i] = zik_element_specs[i].get_type ();
+
+      h = zik_element_types_hash (zik_element_types[i]);
+      while (zik_element_types_table[h] != ZIK_ELEMENT_UNKNOWN)
+        h = (h + 1) & (ZIK_ELEMENT_TYPES_SIZE - 1);
+      zik_element_types_table[h] = i;
     }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_STRING, "room_size", &room_size,
-          G_MARKUP_COLLECT_STRING, "angle", &angle,
-          G_MARKUP_COLLECT_STRING | G_MARKUP_COLLECT_OPTIONAL, "mode", &mode,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_sound_effect_info_new (enabled, room_size, atoi (angle), mode));
-  } else if (g_strcmp0 (element_name, "auto_connection") == 0) {
-    gboolean enabled;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "system")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<auto_connection> element should be embedded in <system>");
-      return;
+    g_once_init_leave (&init, 1);
+  }
+
+  for (i = zik_element_types_hash (type);
+      zik_element_types_table[i] != ZIK_ELEMENT_UNKNOWN;
+      i = (i + 1) & (ZIK_ELEMENT_TYPES_SIZE - 1)) {
+    if (zik_element_types[zik_element_types_table[i]] == type)
+      return &zik_element_specs[zik_element_types_table[i]];
+  }
+
+  return NULL;
+}
+
+/* same rules as G_MARKUP_COLLECT_BOOLEAN */
+static gboolean
+zik_attr_parse_boolean (const gchar * str, gboolean * value)
+{
+  static const gchar *const falses[] = { "false", "f", "no", "n", "0" };
+  static const gchar *const trues[] = { "true", "t", "yes", "y", "1" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (falses); i++) {
+    if (g_ascii_strcasecmp (str, falses[i]) == 0) {
+      *value = FALSE;
+      return TRUE;
     }
+  }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_auto_connection_info_new (enabled));
-  } else if (g_strcmp0 (element_name, "track") == 0) {
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<track> element should be embedded in <audio>");
-      return;
+  for (i = 0; i < G_N_ELEMENTS (trues); i++) {
+    if (g_ascii_strcasecmp (str, trues[i]) == 0) {
+      *value = TRUE;
+      return TRUE;
     }
+  }
 
-    data->parent = g_node_append_data (data->parent, zik_track_info_new ());
-  } else if (g_strcmp0 (element_name, "metadata") == 0) {
-    gboolean playing;
-    const gchar *title;
-    const gchar *artist;
-    const gchar *album;
-    const gchar *genre;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "track")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<metadata> element should be embedded in <track>");
-      return;
+  return FALSE;
+}
+
+/* collect attributes in a single pass over them, failing on unknown,
+ * duplicated or missing ones like g_markup_collect_attributes() */
+static gboolean
+zik_element_collect_attributes (const ZikElementSpec * spec,
+    const gchar ** attribute_names, const gchar ** attribute_values,
+    ZikAttrValue * values, GError ** error)
+{
+  const gchar *strings[ZIK_ATTR_MAX] = { NULL, };
+  guint i;
+  guint j;
+
+  for (i = 0; attribute_names[i] != NULL; i++) {
+    for (j = 0; j < ZIK_ATTR_MAX && spec->attrs[j].name; j++) {
+      if (strcmp (attribute_names[i], spec->attrs[j].name) == 0)
+        break;
     }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "playing", &playing,
-          G_MARKUP_COLLECT_STRING, "title", &title,
-          G_MARKUP_COLLECT_STRING, "artist", &artist,
-          G_MARKUP_COLLECT_STRING, "album", &album,
-          G_MARKUP_COLLECT_STRING, "genre", &genre,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_metadata_info_new (playing, title, artist, album, genre));
-  } else if (g_strcmp0 (element_name, "equalizer") == 0) {
-    gboolean enabled;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<equalizer> element should be embedded in <audio>");
-      return;
+    if (j == ZIK_ATTR_MAX || spec->attrs[j].name == NULL) {
+      g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_UNKNOWN_ATTRIBUTE,
+          "attribute '%s' invalid for element '%s'", attribute_names[i],
+          spec->name);
+      return FALSE;
     }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_equalizer_info_new (enabled));
-  } else if (g_strcmp0 (element_name, "smart_audio_tune") == 0) {
-    gboolean enabled;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "audio")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<smart_audio_tune> element should be embedded in <audio>");
-      return;
+    if (strings[j]) {
+      g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+          "attribute '%s' given multiple times for element '%s'",
+          attribute_names[i], spec->name);
+      return FALSE;
     }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_smart_audio_tune_info_new (enabled));
-  } else if (g_strcmp0 (element_name, "auto_power_off") == 0) {
-    const gchar *value;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "system")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<auto_power_off> element should be embedded in <system>");
-      return;
+    strings[j] = attribute_values[i];
+  }
+
+  for (j = 0; j < ZIK_ATTR_MAX && spec->attrs[j].name; j++) {
+    const ZikAttrSpec *attr = &spec->attrs[j];
+
+    if (strings[j] == NULL && !attr->optional) {
+      g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_MISSING_ATTRIBUTE,
+          "element '%s' requires attribute '%s'", spec->name, attr->name);
+      return FALSE;
     }
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_STRING, "value", &value,
-          G_MARKUP_COLLECT_INVALID))
-      return;
-
-    data->parent = g_node_append_data (data->parent,
-        zik_auto_power_off_info_new (atoi (value)));
-  } else if (g_strcmp0 (element_name, "tts") == 0) {
-    gboolean enabled;
-
-    if (g_slist_length (stack) < 2 || g_strcmp0 (stack->next->data, "answer")) {
-      g_set_error_literal (error, G_MARKUP_ERROR,
-          G_MARKUP_ERROR_INVALID_CONTENT,
-          "<tts> element should be embedded in <answer>");
-      return;
+    switch (attr->type) {
+      case ZIK_ATTR_STRING:
+      case ZIK_ATTR_INTERNED:
+      case ZIK_ATTR_IGNORED:
+        values[j].string = strings[j];
+        break;
+      case ZIK_ATTR_BOOLEAN:
+        values[j].boolean = FALSE;
+        if (strings[j] && !zik_attr_parse_boolean (strings[j],
+                &values[j].boolean)) {
+          g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+              "element '%s', attribute '%s', value '%s' cannot be parsed as "
+              "a boolean value", spec->name, attr->name, strings[j]);
+          return FALSE;
+        }
+        break;
+      case ZIK_ATTR_INT:
+        values[j].integer = strings[j] ? atoi (strings[j]) : 0;
+        break;
+      case ZIK_ATTR_ENUM:
+        /* missing value decodes as unknown one, not as first value */
+        values[j].integer = attr->decode (strings[j] ? strings[j] : "");
+        if (values[j].integer < 0) {
+          g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+              "element '%s', attribute '%s', value '%s' is not known",
+              spec->name, attr->name, strings[j] ? strings[j] : "");
+          return FALSE;
+        }
+        break;
     }
+  }
+
+  return TRUE;
+}
+
+/* Return: index in @spec of attribute stored at @offset of its info */
+static guint
+zik_element_attr_at (const ZikElementSpec * spec, glong offset)
+{
+  guint i;
+
+  for (i = 0; i < ZIK_ATTR_MAX && spec->attrs[i].name; i++) {
+    if (spec->attrs[i].type != ZIK_ATTR_IGNORED &&
+        spec->attrs[i].offset == offset)
+      return i;
+  }
+
+  g_return_val_if_reached (0);
+}
+
+static void
+zik2_xml_parser_start_element (GMarkupParseContext * context,
+    const gchar * element_name, const gchar ** attribute_names,
+    const gchar ** attribute_values, gpointer userdata, GError ** error)
+{
+  ParserData *data = (ParserData *) userdata;
+  const ZikElementSpec *spec;
+  ZikAttrValue values[ZIK_ATTR_MAX];
+  ZikElementId parent;
+  ZikElementId id;
+  ZikRequestReplyData *reply;
+  ZikReplyNode *node;
 
-    if (!g_markup_collect_attributes (element_name, attribute_names,
-          attribute_values, error,
-          G_MARKUP_COLLECT_BOOLEAN, "enabled", &enabled,
-          G_MARKUP_COLLECT_INVALID))
-      return;
+  if (data->finished)
+    return;
+
+  if (data->depth == ZIK_PARSER_MAX_DEPTH) {
+    g_set_error_literal (error, G_MARKUP_ERROR,
+        G_MARKUP_ERROR_INVALID_CONTENT, "elements are nested too deeply");
+    return;
+  }
+
+  parent = data->depth ? data->stack[data->depth - 1] : ZIK_ELEMENT_NONE;
+
+  id = zik_element_lookup (element_name);
+  if (id == ZIK_ELEMENT_UNKNOWN) {
+    /* unknown elements are skipped along with their children */
+    data->stack[data->depth++] = ZIK_ELEMENT_UNKNOWN;
+    return;
+  }
+
+  spec = &zik_element_specs[id];
+  if (spec->parent == ZIK_ELEMENT_NONE && parent != ZIK_ELEMENT_NONE) {
+    g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+        "<%s> elements can only be top-level element", spec->name);
+    return;
+  } else if (spec->parent == ZIK_ELEMENT_ANY && (parent == ZIK_ELEMENT_NONE ||
+          parent == ZIK_ELEMENT_UNKNOWN)) {
+    g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+        "<%s> element should be embedded in <answer>", spec->name);
+    return;
+  } else if (spec->parent > ZIK_ELEMENT_ANY && spec->parent != parent) {
+    g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+        "<%s> element should be embedded in <%s>", spec->name,
+        zik_element_specs[spec->parent].name);
+    return;
+  }
+
+  if (data->target) {
+    /* besides target, only <answer> is looked at for its error flag */
+    if ((spec == data->target && data->info == NULL) ||
+        spec->id == ZIK_ELEMENT_ANSWER) {
+      if (!zik_element_collect_attributes (spec, attribute_names,
+              attribute_values, values, error))
+        return;
+
+      if (spec->id == ZIK_ELEMENT_ANSWER)
+        data->error = values[zik_element_attr_at (spec,
+                G_STRUCT_OFFSET (ZikAnswerInfo, error))].boolean;
+
+      if (spec == data->target) {
+        data->info = zik_element_new_info (spec, values);
+        data->info_depth = data->depth;
+      }
+    }
 
-    data->parent = g_node_append_data (data->parent,
-        zik_tts_info_new (enabled));
+    data->stack[data->depth++] = spec->id;
+    return;
   }
+
+  if (!zik_element_collect_attributes (spec, attribute_names,
+          attribute_values, values, error))
+    return;
+
+  /* infos of reply are owned by it, not refcounted so that ref/unref fail
+   * on them */
+  reply = data->reply;
+  node = zik_reply_alloc (reply, sizeof (ZikReplyNode) + spec->info_size);
+  node->info = node + 1;
+  node->parent = data->parent;
+  zik_element_init_info (spec, values, node->info, reply);
+
+  if (spec->id == ZIK_ELEMENT_ANSWER)
+    reply->root = node;
+
+  if (reply->last[spec->id])
+    reply->last[spec->id]->next_same = node;
+  else
+    reply->first[spec->id] = node;
+  reply->last[spec->id] = node;
+
+  data->parent = node;
+
+  data->stack[data->depth++] = spec->id;
 }
 
 static void
@@ -439,13 +594,27 @@ zik2_xml_parser_end_element (GMarkupParseContext * context,
     const gchar * element_name, gpointer userdata, GError **error)
 {
   ParserData *data = (ParserData *) userdata;
+  ZikElementId id;
+
+  if (data->finished || data->depth == 0)
+    return;
+
+  id = data->stack[--data->depth];
 
-  if (g_strcmp0 (element_name, "answer") == 0) {
+  if (id == ZIK_ELEMENT_ANSWER) {
     data->finished = TRUE;
     data->parent = NULL;
-  } else {
+  } else if (data->target) {
+    if (data->info && data->depth == data->info_depth)
+      data->finished = TRUE;
+  } else if (id != ZIK_ELEMENT_UNKNOWN) {
     data->parent = data->parent->parent;
   }
+
+  /* stop GMarkup there, like tokenizer does */
+  if (data->finished && context)
+    g_set_error_literal (error, G_MARKUP_ERROR, G_MARKUP_ERROR_PARSE,
+        "parsing finished");
 }
 
 static void
@@ -468,165 +637,891 @@ static const GMarkupParser zik_request_reply_xml_parser_cbs = {
   .error = zik2_xml_parser_error
 };
 
+/* Answers only use a small subset of XML: an optional declaration then
+ * elements holding attributes and other elements, no text. The tokenizer
+ * below handles this subset straight from the payload and feeds the same
+ * callbacks as GMarkup, each complete tag being copied to a scratch buffer
+ * to terminate its strings. Anything else (comments, CDATA, text,
+ * unknown entities, invalid UTF-8, malformed tags...) makes it give up so
+ * that GMarkup parses the answer instead.
+ *
+ * Input may be given in several parts, the tokenizer stopping before an
+ * incomplete tag and resuming from it once more input is there */
 
-/** ZikMessage API */
-
-void
-zik_message_free (ZikMessage * msg)
-{
-  g_free (msg->payload);
-  g_slice_free (ZikMessage, msg);
-}
+#define ZIK_XML_MAX_ATTRS 16
+#define ZIK_XML_SCRATCH_SIZE 1024
+#define ZIK_XML_NAMES_SIZE 256
 
+/* request reply seems to begin with 0x01 0x01 and the payload size again
+ * on the two following bytes in network bytes order, xml follows */
+#define ZIK_REPLY_PREAMBLE_LEN 4
 
-/* free after usage */
-guint8 *
-zik_message_make_buffer (ZikMessage * msg, gsize *out_size)
+typedef enum
 {
-  guint16 size;
-  guint8 *data;
-
-  if (ZIK_MESSAGE_HEADER_LEN + msg->payload_size > G_MAXUINT16)
-    return NULL;
-
-  size = ZIK_MESSAGE_HEADER_LEN + msg->payload_size;
-  data = g_malloc (size);
+  ZIK_XML_OK,
+  ZIK_XML_ERROR,
+  ZIK_XML_UNSUPPORTED,
+  /* more input is needed */
+  ZIK_XML_AGAIN
+} ZikXmlResult;
 
-  /* header structure is
-   *   uint16_t: length of header + payload in network byte order
-   *   uint8_t:  message id
-   */
+typedef struct
+{
+  /* input, left untouched. It may be moved between calls as long as its
+   * first bytes stay the same, only offsets in it are kept */
+  const gchar *input;
+  gsize size;
+  /* where next token starts */
+  gsize pos;
+
+  /* names of open elements, copied to match end tags once input they were
+   * in is gone */
+  gchar names[ZIK_XML_NAMES_SIZE];
+  guint names_len;
+  guint open[ZIK_PARSER_MAX_DEPTH];
+  guint depth;
+} ZikXmlTokenizer;
+
+static gboolean zik_message_strict_xml = FALSE;
+
+static inline gboolean
+zik_xml_is_name_start (gchar c)
+{
+  return g_ascii_isalpha (c) || c == '_' || c == ':';
+}
 
-  *((guint16 *) data) = g_htons (size);
-  data[2] = msg->id;
+static inline gboolean
+zik_xml_is_name_char (gchar c)
+{
+  return g_ascii_isalnum (c) || c == '_' || c == ':' || c == '.' || c == '-';
+}
 
-  if (msg->payload)
-    memcpy (data + 3, msg->payload, msg->payload_size);
+static inline const gchar *
+zik_xml_skip_spaces (const gchar * p, const gchar * end)
+{
+  while (p < end && g_ascii_isspace (*p))
+    p++;
 
-  *out_size = size;
-  return data;
+  return p;
 }
 
-ZikMessage *
-zik_message_new_from_buffer (const guint8 * data, gsize size)
+static inline const gchar *
+zik_xml_skip_name (const gchar * p, const gchar * end)
 {
-  ZikMessage *msg;
-  gsize msg_size;
+  while (p < end && zik_xml_is_name_char (*p))
+    p++;
 
-  if (size < ZIK_MESSAGE_HEADER_LEN)
-    goto too_small;
+  return p;
+}
 
-  msg_size = g_ntohs (*((guint16 *) data));
+/* decode entities of @str in place, decoded text being never longer */
+static gboolean
+zik_xml_unescape (gchar * str)
+{
+  gchar *r = str;
+  gchar *w = str;
 
-  if (msg_size < ZIK_MESSAGE_HEADER_LEN || msg_size > size)
-    goto bad_size;
+  while (*r) {
+    gchar *ent;
+    gchar *end;
+    gsize len;
 
-  msg = g_slice_new0 (ZikMessage);
-  msg->id = data[2];
+    if (*r != '&') {
+      *w++ = *r++;
+      continue;
+    }
 
-  msg->payload_size = msg_size - ZIK_MESSAGE_HEADER_LEN;
-  msg->payload = g_malloc (msg->payload_size);
-  memcpy (msg->payload, data + 3, msg->payload_size);
-  return msg;
+    ent = r + 1;
+    end = strchr (ent, ';');
+    if (end == NULL)
+      return FALSE;
+
+    len = end - ent;
+
+    if (len == 2 && strncmp (ent, "lt", 2) == 0) {
+      *w++ = '<';
+    } else if (len == 2 && strncmp (ent, "gt", 2) == 0) {
+      *w++ = '>';
+    } else if (len == 3 && strncmp (ent, "amp", 3) == 0) {
+      *w++ = '&';
+    } else if (len == 4 && strncmp (ent, "quot", 4) == 0) {
+      *w++ = '"';
+    } else if (len == 4 && strncmp (ent, "apos", 4) == 0) {
+      *w++ = '\'';
+    } else if (len > 1 && ent[0] == '#') {
+      gchar *num_end;
+      guint64 c;
+
+      if (ent[1] == 'x')
+        c = g_ascii_strtoull (ent + 2, &num_end, 16);
+      else
+        c = g_ascii_strtoull (ent + 1, &num_end, 10);
+
+      if (num_end != end || !g_ascii_isxdigit (ent[ent[1] == 'x' ? 2 : 1]) ||
+          c == 0 || c > 0x10FFFF || !g_unichar_validate (c))
+        return FALSE;
+
+      w += g_unichar_to_utf8 (c, w);
+    } else {
+      return FALSE;
+    }
 
-too_small:
-  g_critical ("data is too small to contain a ZikMessage");
-  return NULL;
+    r = end + 1;
+  }
 
-bad_size:
-  g_critical ("bad size in buffer: %" G_GSIZE_FORMAT, msg_size);
-  return NULL;
+  *w = '\0';
+  return TRUE;
 }
 
-ZikMessage *
-zik_message_new_open_session (void)
+static void
+zik_xml_tokenizer_init (ZikXmlTokenizer * tok, const gchar * input,
+    gsize size)
 {
-  ZikMessage *msg;
-
-  msg = g_slice_new0 (ZikMessage);
-  msg->id = ZIK_MESSAGE_ID_OPEN_SESSION;
-  msg->payload = NULL;
-  msg->payload_size = 0;
-
-  return msg;
+  tok->input = input;
+  tok->size = size;
+  tok->pos = 0;
+  tok->names_len = 0;
+  tok->depth = 0;
 }
 
-ZikMessage *
-zik_message_new_close_session (void)
+/* no more input: only trailing spaces may be left */
+static ZikXmlResult
+zik_xml_tokenizer_end (ZikXmlTokenizer * tok)
 {
-  ZikMessage *msg;
-
-  msg = g_slice_new0 (ZikMessage);
-  msg->id = ZIK_MESSAGE_ID_CLOSE_SESSION;
+  if (tok->depth == 0 && tok->pos == tok->size)
+    return ZIK_XML_OK;
 
-  return msg;
+  return ZIK_XML_UNSUPPORTED;
 }
 
-gboolean
-zik_message_is_acknowledge (ZikMessage * msg)
-{
-  return msg->id == ZIK_MESSAGE_ID_ACK;
-}
+/* a failure at the very end of input may only be due to input being cut */
+#define ZIK_XML_FAIL(p) \
+  return (p) + 1 >= end ? ZIK_XML_AGAIN : ZIK_XML_UNSUPPORTED
 
-/* arg is the string that follow arg=%s and could be NULL */
-ZikMessage *
-zik_message_new_request (const gchar * path, const gchar * method,
-    const gchar * args)
+/* Tokenize from tok->pos, stopping before an incomplete tag so that
+ * tokenizing can resume from tok->pos when ZIK_XML_AGAIN is returned */
+static ZikXmlResult
+zik_xml_tokenize (ZikXmlTokenizer * tok, ParserData * pdata, GError ** error)
 {
-  ZikMessage *msg;
+  gchar scratch[ZIK_XML_SCRATCH_SIZE];
+  const gchar *names[ZIK_XML_MAX_ATTRS + 1];
+  const gchar *values[ZIK_XML_MAX_ATTRS + 1];
+  const gchar *name_ends[ZIK_XML_MAX_ATTRS];
+  const gchar *value_ends[ZIK_XML_MAX_ATTRS];
+  gboolean escaped[ZIK_XML_MAX_ATTRS];
+  const gchar *end = tok->input + tok->size;
+  const gchar *p = tok->input + tok->pos;
+
+  while (TRUE) {
+    const gchar *tag;
+    const gchar *name;
+    const gchar *name_end;
+    gchar *copy;
+    gsize len;
+    gboolean empty;
+    guint n_attrs = 0;
+    guint i;
+
+    p = zik_xml_skip_spaces (p, end);
+    tok->pos = p - tok->input;
+    if (p == end)
+      return ZIK_XML_AGAIN;
+
+    /* text content */
+    if (*p != '<')
+      return ZIK_XML_UNSUPPORTED;
+    tag = p++;
+    if (p == end)
+      return ZIK_XML_AGAIN;
+
+    if (*p == '?') {
+      const gchar *decl = p;
+
+      /* xml declaration */
+      do {
+        p = zik_scan3 (p + 1, end, '?', '?', '?');
+        if (p + 1 >= end)
+          return ZIK_XML_AGAIN;
+      } while (p[1] != '>');
+
+      if (!g_utf8_validate (decl, p - decl, NULL))
+        return ZIK_XML_UNSUPPORTED;
+
+      p += 2;
+      continue;
+    }
 
-  msg = g_slice_new0 (ZikMessage);
-  msg->id = ZIK_MESSAGE_ID_REQ;
+    if (*p == '/') {
+      const gchar *open;
 
-  if (args)
-    msg->payload = g_strdup_printf ("GET %s/%s?arg=%s", path, method, args);
-  else
-    msg->payload = g_strdup_printf ("GET %s/%s", path, method);
+      /* end tag */
+      name = ++p;
+      p = zik_xml_skip_name (p, end);
+      name_end = p;
 
-  msg->payload_size = strlen ((gchar *) msg->payload);
+      p = zik_xml_skip_spaces (p, end);
+      if (p == end)
+        return ZIK_XML_AGAIN;
+      if (*p != '>')
+        ZIK_XML_FAIL (p);
+      p++;
 
-  return msg;
-}
+      if (tok->depth == 0)
+        return ZIK_XML_UNSUPPORTED;
 
-gboolean
-zik_message_is_request (ZikMessage * msg)
-{
-  return msg->id == ZIK_MESSAGE_ID_REQ;
-}
+      open = tok->names + tok->open[tok->depth - 1];
+      if (strlen (open) != (gsize) (name_end - name) ||
+          memcmp (open, name, name_end - name) != 0)
+        return ZIK_XML_UNSUPPORTED;
 
-gboolean
-zik_message_parse_request_reply (ZikMessage * msg,
-    ZikRequestReplyData ** reply)
+      tok->names_len = tok->open[--tok->depth];
+
+      /* copy of the name is still there */
+      zik2_xml_parser_end_element (NULL, open, pdata, error);
+      tok->pos = p - tok->input;
+      if (tok->depth == 0 || pdata->finished)
+        return ZIK_XML_OK;
+
+      continue;
+    }
+
+    /* start tag, comments, CDATA and doctype are not expected */
+    if (!zik_xml_is_name_start (*p))
+      ZIK_XML_FAIL (p);
+
+    name = p;
+    p = zik_xml_skip_name (p, end);
+    name_end = p;
+
+    while (TRUE) {
+      gchar quote;
+
+      if (p == end)
+        return ZIK_XML_AGAIN;
+      if (!g_ascii_isspace (*p) && *p != '/' && *p != '>')
+        ZIK_XML_FAIL (p);
+
+      p = zik_xml_skip_spaces (p, end);
+      if (p == end)
+        return ZIK_XML_AGAIN;
+      if (p[0] == '/' && p + 1 < end && p[1] == '>') {
+        empty = TRUE;
+        p += 2;
+        break;
+      } else if (*p == '>') {
+        empty = FALSE;
+        p++;
+        break;
+      }
+
+      if (!zik_xml_is_name_start (*p) || n_attrs == ZIK_XML_MAX_ATTRS)
+        ZIK_XML_FAIL (p);
+
+      names[n_attrs] = p;
+      p = zik_xml_skip_name (p, end);
+      name_ends[n_attrs] = p;
+
+      p = zik_xml_skip_spaces (p, end);
+      if (p == end)
+        return ZIK_XML_AGAIN;
+      if (*p != '=')
+        ZIK_XML_FAIL (p);
+      p = zik_xml_skip_spaces (p + 1, end);
+      if (p == end)
+        return ZIK_XML_AGAIN;
+
+      quote = *p;
+      if (quote != '"' && quote != '\'')
+        ZIK_XML_FAIL (p);
+
+      /* value runs are the longest part of answers (track metadata),
+       * find their end and validate them in a single vectorized pass */
+      values[n_attrs] = ++p;
+      escaped[n_attrs] = FALSE;
+      while (TRUE) {
+        p = zik_scan3 (p, end, quote, '<', '&');
+        if (p == end)
+          return ZIK_XML_AGAIN;
+
+        if (*p == '<')
+          return ZIK_XML_UNSUPPORTED;
+
+        if (*p == quote)
+          break;
+
+        escaped[n_attrs] = TRUE;
+        p++;
+      }
+
+      value_ends[n_attrs] = p++;
+      n_attrs++;
+    }
+
+    if (tok->depth == ZIK_PARSER_MAX_DEPTH)
+      return ZIK_XML_UNSUPPORTED;
+
+    /* names are ASCII, GMarkup rejects values which aren't UTF-8 */
+    for (i = 0; i < n_attrs; i++) {
+      if (!g_utf8_validate (values[i], value_ends[i] - values[i], NULL))
+        return ZIK_XML_UNSUPPORTED;
+    }
+
+    if (!empty) {
+      len = name_end - name;
+      if (tok->names_len + len + 1 > sizeof (tok->names))
+        return ZIK_XML_UNSUPPORTED;
+    }
+
+    /* tag is complete, its strings are terminated in a copy of it */
+    len = p - tag;
+    copy = len < sizeof (scratch) ? scratch : g_malloc (len + 1);
+    memcpy (copy, tag, len);
+
+#define ZIK_XML_IN_COPY(ptr) (copy + ((ptr) - tag))
+
+    copy[name_end - tag] = '\0';
+    for (i = 0; i < n_attrs; i++) {
+      *ZIK_XML_IN_COPY (name_ends[i]) = '\0';
+      *ZIK_XML_IN_COPY (value_ends[i]) = '\0';
+      names[i] = ZIK_XML_IN_COPY (names[i]);
+      values[i] = ZIK_XML_IN_COPY (values[i]);
+
+      if (escaped[i] && !zik_xml_unescape ((gchar *) values[i])) {
+        if (copy != scratch)
+          g_free (copy);
+        return ZIK_XML_UNSUPPORTED;
+      }
+    }
+
+    names[n_attrs] = NULL;
+    values[n_attrs] = NULL;
+
+    zik2_xml_parser_start_element (NULL, ZIK_XML_IN_COPY (name), names,
+        values, pdata, error);
+    if (*error == NULL && empty)
+      zik2_xml_parser_end_element (NULL, ZIK_XML_IN_COPY (name), pdata,
+          error);
+
+#undef ZIK_XML_IN_COPY
+
+    if (copy != scratch)
+      g_free (copy);
+
+    if (*error)
+      return ZIK_XML_ERROR;
+
+    if (empty) {
+      if (tok->depth == 0 || pdata->finished) {
+        tok->pos = p - tok->input;
+        return ZIK_XML_OK;
+      }
+    } else {
+      len = name_end - name;
+      memcpy (tok->names + tok->names_len, name, len);
+      tok->names[tok->names_len + len] = '\0';
+      tok->open[tok->depth++] = tok->names_len;
+      tok->names_len += len + 1;
+    }
+  }
+}
+
+static ZikXmlResult
+zik_xml_parse (const gchar * xml, gsize size, ParserData * pdata,
+    GError ** error)
 {
-  ZikRequestReplyData *result;
-  GMarkupParseContext *parser;
-  ParserData pdata;
-  gchar *xml;
-  gssize xml_size;
-  GError *error = NULL;
-  gboolean ret = FALSE;
+  ZikXmlTokenizer tok;
+  ZikXmlResult res;
 
-  g_return_val_if_fail (zik_message_is_request (msg), FALSE);
+  /* strings of tags are NUL terminated once copied */
+  if (memchr (xml, '\0', size))
+    return ZIK_XML_UNSUPPORTED;
+
+  zik_xml_tokenizer_init (&tok, xml, size);
+  res = zik_xml_tokenize (&tok, pdata, error);
+  if (res == ZIK_XML_AGAIN)
+    res = zik_xml_tokenizer_end (&tok);
+
+  return res;
+}
+
+/* Parse answers with GMarkup only, for debugging */
+void
+zik_message_set_strict_xml (gboolean strict)
+{
+  zik_message_strict_xml = strict;
+}
+
+
+/** ZikMessage API */
+
+/* size in header, data may not be aligned when it comes from decoder */
+static inline gsize
+zik_message_read_size (const guint8 * data)
+{
+  return (data[0] << 8) | data[1];
+}
+
+void
+zik_message_free (ZikMessage * msg)
+{
+  if (msg->frame)
+    return;
+
+  if (msg->decoder)
+    g_queue_unlink (&msg->decoder->messages, &msg->link);
+  else
+    g_free (msg->payload);
+
+  g_slice_free (ZikMessage, msg);
+}
+
+
+/* Return: (transfer full): a copy of @msg which doesn't depend on any
+ * receive buffer */
+ZikMessage *
+zik_message_copy (ZikMessage * msg)
+{
+  ZikMessage *copy;
+
+  /* immutable */
+  if (msg->frame)
+    return msg;
+
+  copy = g_slice_new0 (ZikMessage);
+  copy->id = msg->id;
+  copy->payload_size = msg->payload_size;
+
+  if (msg->payload)
+    copy->payload = g_memdup (msg->payload, msg->payload_size);
+
+  return copy;
+}
+
+/* write the ZIK_MESSAGE_HEADER_LEN bytes of header, return FALSE if
+ * message is too big */
+gboolean
+zik_message_write_header (ZikMessage * msg, guint8 * header)
+{
+  gsize size;
+
+  if (ZIK_MESSAGE_HEADER_LEN + msg->payload_size > G_MAXUINT16)
+    return FALSE;
+
+  size = ZIK_MESSAGE_HEADER_LEN + msg->payload_size;
+
+  /* header structure is
+   *   uint16_t: length of header + payload in network byte order
+   *   uint8_t:  message id
+   */
+  header[0] = size >> 8;
+  header[1] = size & 0xff;
+  header[2] = msg->id;
+
+  return TRUE;
+}
+
+/* Return: (transfer none): payload, which could be NULL if empty */
+const gchar *
+zik_message_peek_payload (ZikMessage * msg, gsize * size)
+{
+  *size = msg->payload_size;
+  return msg->payload;
+}
+
+/* free after usage */
+guint8 *
+zik_message_make_buffer (ZikMessage * msg, gsize *out_size)
+{
+  gsize size;
+  guint8 *data;
+
+  if (ZIK_MESSAGE_HEADER_LEN + msg->payload_size > G_MAXUINT16)
+    return NULL;
+
+  size = ZIK_MESSAGE_HEADER_LEN + msg->payload_size;
+  *out_size = size;
+
+  if (msg->frame)
+    return g_memdup (msg->frame, size);
+
+  data = g_malloc (size);
+
+  zik_message_write_header (msg, data);
+
+  if (msg->payload)
+    memcpy (data + ZIK_MESSAGE_HEADER_LEN, msg->payload, msg->payload_size);
+
+  return data;
+}
+
+ZikMessage *
+zik_message_new_from_buffer (const guint8 * data, gsize size)
+{
+  ZikMessage *msg;
+  gsize msg_size;
+
+  if (size < ZIK_MESSAGE_HEADER_LEN)
+    goto too_small;
+
+  msg_size = zik_message_read_size (data);
+
+  if (msg_size < ZIK_MESSAGE_HEADER_LEN || msg_size > size)
+    goto bad_size;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = data[2];
+
+  msg->payload_size = msg_size - ZIK_MESSAGE_HEADER_LEN;
+  msg->payload = g_malloc (msg->payload_size);
+  memcpy (msg->payload, data + 3, msg->payload_size);
+  return msg;
+
+too_small:
+  g_critical ("data is too small to contain a ZikMessage");
+  return NULL;
 
-  result = g_slice_new0 (ZikRequestReplyData);
+bad_size:
+  g_critical ("bad size in buffer: %" G_GSIZE_FORMAT, msg_size);
+  return NULL;
+}
+
+ZikMessage *
+zik_message_new_open_session (void)
+{
+  ZikMessage *msg;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = ZIK_MESSAGE_ID_OPEN_SESSION;
+  msg->payload = NULL;
+  msg->payload_size = 0;
+
+  return msg;
+}
+
+ZikMessage *
+zik_message_new_close_session (void)
+{
+  ZikMessage *msg;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = ZIK_MESSAGE_ID_CLOSE_SESSION;
+
+  return msg;
+}
+
+gboolean
+zik_message_is_open_session (ZikMessage * msg)
+{
+  return msg->id == ZIK_MESSAGE_ID_OPEN_SESSION;
+}
+
+gboolean
+zik_message_is_close_session (ZikMessage * msg)
+{
+  return msg->id == ZIK_MESSAGE_ID_CLOSE_SESSION;
+}
+
+ZikMessage *
+zik_message_new_acknowledge (void)
+{
+  ZikMessage *msg;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = ZIK_MESSAGE_ID_ACK;
+
+  return msg;
+}
+
+gboolean
+zik_message_is_acknowledge (ZikMessage * msg)
+{
+  return msg->id == ZIK_MESSAGE_ID_ACK;
+}
+
+/* build frames of all API paths in a single block */
+static void
+zik_request_frames_init (void)
+{
+  gsize size = 0;
+  guint8 *data;
+  guint i;
+  guint j;
+
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    for (j = 0; j < ZIK_N_REQUEST_FRAMES; j++) {
+      /* payloads are nul-terminated as other requests */
+      size += ZIK_MESSAGE_HEADER_LEN + strlen ("GET /") +
+          strlen (zik_api_paths[i].path) +
+          strlen (zik_request_frame_specs[j].method) + 1;
+      if (zik_request_frame_specs[j].args)
+        size += strlen ("?arg=") + strlen (zik_request_frame_specs[j].args);
+    }
+  }
+
+  data = g_malloc (size);
+
+  for (i = 0; i < ZIK_N_API_PATHS; i++) {
+    for (j = 0; j < ZIK_N_REQUEST_FRAMES; j++) {
+      ZikMessage *msg = &zik_request_frames[i][j];
+      gchar *payload = (gchar *) data + ZIK_MESSAGE_HEADER_LEN;
+      gchar *end;
+
+      end = g_stpcpy (payload, "GET ");
+      end = g_stpcpy (end, zik_api_paths[i].path);
+      end = g_stpcpy (end, "/");
+      end = g_stpcpy (end, zik_request_frame_specs[j].method);
+      if (zik_request_frame_specs[j].args) {
+        end = g_stpcpy (end, "?arg=");
+        end = g_stpcpy (end, zik_request_frame_specs[j].args);
+      }
+
+      msg->id = ZIK_MESSAGE_ID_REQ;
+      msg->payload = payload;
+      msg->payload_size = end - payload;
+      msg->frame = data;
+      zik_message_write_header (msg, data);
+
+      data = (guint8 *) end + 1;
+    }
+  }
+}
+
+/* Return: frames of @path or NULL if it isn't an API path */
+static ZikMessage *
+zik_request_frames_lookup (const gchar * path)
+{
+  static gsize init = 0;
+  ZikApiPathId id;
+
+  id = zik_api_path_lookup (path, strlen (path));
+  if (id == ZIK_API_PATH_UNKNOWN)
+    return NULL;
+
+  if (g_once_init_enter (&init)) {
+    zik_request_frames_init ();
+    g_once_init_leave (&init, 1);
+  }
+
+  return zik_request_frames[id];
+}
+
+/* arg is the string that follow arg=%s and could be NULL. Requests of API
+ * paths without argument or with a boolean one are prebuilt, they are
+ * neither allocated nor freed */
+ZikMessage *
+zik_message_new_request (const gchar * path, const gchar * method,
+    const gchar * args)
+{
+  ZikMessage *frames;
+  ZikMessage *msg;
+  gsize prefix_len;
+  gsize method_len;
+  gsize args_len;
+  gchar *payload;
+  guint i;
+
+  frames = zik_request_frames_lookup (path);
+  for (i = 0; frames && i < ZIK_N_REQUEST_FRAMES; i++) {
+    if (strcmp (method, zik_request_frame_specs[i].method) == 0 &&
+        g_strcmp0 (args, zik_request_frame_specs[i].args) == 0)
+      return &frames[i];
+  }
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = ZIK_MESSAGE_ID_REQ;
+
+  /* "GET <path>/" of API paths is taken from their get request */
+  if (frames) {
+    prefix_len = frames[ZIK_REQUEST_FRAME_GET].payload_size - strlen ("get");
+  } else {
+    prefix_len = strlen ("GET /") + strlen (path);
+  }
+  method_len = strlen (method);
+  args_len = args ? strlen ("?arg=") + strlen (args) : 0;
+
+  msg->payload_size = prefix_len + method_len + args_len;
+  msg->payload = payload = g_malloc (msg->payload_size + 1);
+
+  if (frames) {
+    memcpy (payload, frames[ZIK_REQUEST_FRAME_GET].payload, prefix_len);
+    payload += prefix_len;
+  } else {
+    payload = g_stpcpy (payload, "GET ");
+    payload = g_stpcpy (payload, path);
+    payload = g_stpcpy (payload, "/");
+  }
+
+  memcpy (payload, method, method_len);
+  payload += method_len;
+
+  if (args) {
+    payload = g_stpcpy (payload, "?arg=");
+    payload = g_stpcpy (payload, args);
+  }
+  *payload = '\0';
+
+  return msg;
+}
+
+gboolean
+zik_message_is_request (ZikMessage * msg)
+{
+  return msg->id == ZIK_MESSAGE_ID_REQ;
+}
+
+/* Return: (transfer none): the path and method of the request, ie
+ * "/api/audio/volume/get", not nul-terminated */
+const gchar *
+zik_message_peek_request_path (ZikMessage * msg, gsize * len)
+{
+  const gchar *path;
+  const gchar *end;
+
+  g_return_val_if_fail (zik_message_is_request (msg), NULL);
+
+  if (msg->payload_size < 4 || memcmp (msg->payload, "GET ", 4) != 0)
+    return NULL;
+
+  path = msg->payload + 4;
+  end = memchr (path, '?', msg->payload_size - 4);
+  if (end == NULL)
+    end = msg->payload + msg->payload_size;
+
+  *len = end - path;
+  return path;
+}
+
+/* Return: (transfer none): the args of the request, after "?arg=", or NULL
+ * if there is none. Not nul-terminated */
+const gchar *
+zik_message_peek_request_args (ZikMessage * msg, gsize * len)
+{
+  const gchar *args;
+  const gchar *end;
+
+  g_return_val_if_fail (zik_message_is_request (msg), NULL);
+
+  end = msg->payload + msg->payload_size;
+  args = memchr (msg->payload, '?', msg->payload_size);
+  if (args == NULL || end - args < 5 || memcmp (args, "?arg=", 5) != 0)
+    return NULL;
+
+  args += 5;
+  *len = end - args;
+  return args;
+}
+
+/* Make the answer to a request, as sent by device, from @xml which is not
+ * necessarily nul-terminated */
+ZikMessage *
+zik_message_new_request_reply (const gchar * xml, gsize xml_size)
+{
+  ZikMessage *msg;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = ZIK_MESSAGE_ID_REQ;
+  msg->payload_size = xml_size + 4;
+  msg->payload = g_malloc (msg->payload_size);
+
+  /* see zik_message_parse_request_reply() about the 4 first bytes */
+  msg->payload[0] = 0x01;
+  msg->payload[1] = 0x01;
+  msg->payload[2] = (msg->payload_size >> 8) & 0xff;
+  msg->payload[3] = msg->payload_size & 0xff;
+  memcpy (msg->payload + 4, xml, xml_size);
+
+  return msg;
+}
+
+/* Return: (transfer none): the path attribute of <answer> without parsing
+ * the whole reply, not nul-terminated */
+const gchar *
+zik_message_peek_request_reply_path (ZikMessage * msg, gsize * len)
+{
+  const gchar *xml;
+  const gchar *path;
+  const gchar *end;
+  gsize xml_size;
+
+  g_return_val_if_fail (zik_message_is_request (msg), NULL);
+
+  if (msg->payload_size < 4)
+    return NULL;
 
-  /* request reply seems to begin with 0x01 0x01 and the payload size again
-   * on the two following bytes in network bytes order
-   * hence xml size is payload_size - 4 */
   xml = msg->payload + 4;
   xml_size = msg->payload_size - 4;
 
-  memset (&pdata, 0, sizeof (pdata));
+  path = g_strstr_len (xml, xml_size, "path=\"");
+  if (path == NULL)
+    return NULL;
+
+  path += strlen ("path=\"");
+  end = memchr (path, '"', xml + xml_size - path);
+  if (end == NULL)
+    return NULL;
+
+  *len = end - path;
+  return path;
+}
+
+/* @target: NULL to build a tree */
+static void
+zik_parser_data_init (ParserData * pdata, const ZikElementSpec * target)
+{
+  memset (pdata, 0, sizeof (*pdata));
+  pdata->target = target;
+
+  /* targeted mode builds no tree */
+  if (target == NULL)
+    pdata->reply = zik_request_reply_data_new ();
+}
+
+static void
+zik_parser_data_clear (ParserData * pdata)
+{
+  if (pdata->reply)
+    zik_request_reply_data_free (pdata->reply);
+
+  if (pdata->info)
+    g_boxed_free (pdata->target->get_type (), pdata->info);
+
+  memset (pdata, 0, sizeof (*pdata));
+}
+
+static void
+zik_parser_data_reset (ParserData * pdata)
+{
+  const ZikElementSpec *target = pdata->target;
 
+  zik_parser_data_clear (pdata);
+  zik_parser_data_init (pdata, target);
+}
+
+/* parse answer with GMarkup, @pdata is cleared on failure */
+static gboolean
+zik_message_parse_answer_markup (ZikMessage * msg, ParserData * pdata)
+{
+  GMarkupParseContext *parser;
+  GError *error = NULL;
+
+  /* once finished, parsing is stopped with an error and the rest of the
+   * answer isn't looked at */
   parser = g_markup_parse_context_new (&zik_request_reply_xml_parser_cbs, 0,
-      &pdata, NULL);
-  if (!g_markup_parse_context_parse (parser, xml, xml_size, &error)) {
+      pdata, NULL);
+  if (!g_markup_parse_context_parse (parser,
+          msg->payload + ZIK_REPLY_PREAMBLE_LEN,
+          msg->payload_size - ZIK_REPLY_PREAMBLE_LEN, &error)) {
+    if (pdata->finished) {
+      g_error_free (error);
+      g_markup_parse_context_free (parser);
+      return TRUE;
+    }
+
     g_critical ("failed to parse request reply: %s", error->message);
-    /* use result to ease cleanup */
-    result->root = pdata.root;
-    zik_request_reply_data_free (result);
     g_error_free (error);
-    goto out;
+    g_markup_parse_context_free (parser);
+    zik_parser_data_clear (pdata);
+    return FALSE;
   }
 
   if (!g_markup_parse_context_end_parse (parser, &error)) {
@@ -634,14 +1529,241 @@ zik_message_parse_request_reply (ZikMessage * msg,
     g_error_free (error);
   }
 
-  result->root = pdata.root;
-  *reply = result;
+  g_markup_parse_context_free (parser);
+  return TRUE;
+}
+
+/* parse answer into @pdata, initialized, which is cleared on failure */
+static gboolean
+zik_message_parse_answer (ZikMessage * msg, ParserData * pdata)
+{
+  GError *error = NULL;
+
+  if (zik_message_strict_xml)
+    return zik_message_parse_answer_markup (msg, pdata);
+
+  switch (zik_xml_parse (msg->payload + ZIK_REPLY_PREAMBLE_LEN,
+          msg->payload_size - ZIK_REPLY_PREAMBLE_LEN, pdata, &error)) {
+    case ZIK_XML_OK:
+      return TRUE;
+    case ZIK_XML_ERROR:
+      g_critical ("failed to parse request reply: %s", error->message);
+      g_error_free (error);
+      zik_parser_data_clear (pdata);
+      return FALSE;
+    default:
+      /* start again with GMarkup */
+      zik_parser_data_reset (pdata);
+      return zik_message_parse_answer_markup (msg, pdata);
+  }
+}
+
+gboolean
+zik_message_parse_request_reply (ZikMessage * msg,
+    ZikRequestReplyData ** reply)
+{
+  ParserData pdata;
 
-  ret = TRUE;
+  g_return_val_if_fail (zik_message_is_request (msg), FALSE);
 
-out:
-  g_markup_parse_context_free (parser);
-  return ret;
+  zik_parser_data_init (&pdata, NULL);
+
+  if (!zik_message_parse_answer (msg, &pdata))
+    return FALSE;
+
+  *reply = pdata.reply;
+  return TRUE;
+}
+
+/* Parse only the first info of @type of the answer, skipping the rest of it.
+ * @info: (out) (transfer full): the info or NULL if answer has none
+ * @error: (out): whether answer is flagged as an error */
+gboolean
+zik_message_parse_request_reply_info (ZikMessage * msg, GType type,
+    gpointer * info, gboolean * error)
+{
+  const ZikElementSpec *target;
+  ParserData pdata;
+
+  g_return_val_if_fail (zik_message_is_request (msg), FALSE);
+
+  target = zik_element_spec_for_type (type);
+  g_return_val_if_fail (target != NULL, FALSE);
+
+  zik_parser_data_init (&pdata, target);
+
+  if (!zik_message_parse_answer (msg, &pdata))
+    return FALSE;
+
+  *info = pdata.info;
+  *error = pdata.error;
+  return TRUE;
+}
+
+/** ZikReplyParser API */
+
+struct _ZikReplyParser
+{
+  ParserData pdata;
+  ZikXmlTokenizer tok;
+
+  /* payload bytes given so far */
+  gsize fed;
+
+  /* ZIK_XML_AGAIN until answer end or failure */
+  ZikXmlResult res;
+  GError *error;
+};
+
+/* Parser to be fed with answer payload as it is received. It tokenizes
+ * the payload where it is received, the decoder buffering the whole frame
+ * anyway since the answer is handed over as a message and GMarkup fallback
+ * needs all of it. Only offsets in it are kept between calls.
+ * @type: info type to get, G_TYPE_NONE to get whole reply */
+ZikReplyParser *
+zik_reply_parser_new (GType type)
+{
+  ZikReplyParser *parser;
+  const ZikElementSpec *target = NULL;
+
+  if (type != G_TYPE_NONE) {
+    target = zik_element_spec_for_type (type);
+    g_return_val_if_fail (target != NULL, NULL);
+  }
+
+  parser = g_slice_new0 (ZikReplyParser);
+  zik_parser_data_init (&parser->pdata, target);
+  zik_xml_tokenizer_init (&parser->tok, NULL, 0);
+  parser->res = zik_message_strict_xml ? ZIK_XML_UNSUPPORTED : ZIK_XML_AGAIN;
+
+  return parser;
+}
+
+void
+zik_reply_parser_free (ZikReplyParser * parser)
+{
+  zik_parser_data_clear (&parser->pdata);
+  g_clear_error (&parser->error);
+  g_slice_free (ZikReplyParser, parser);
+}
+
+/* forget what has been fed, answer turned out to be for someone else */
+void
+zik_reply_parser_reset (ZikReplyParser * parser)
+{
+  zik_parser_data_reset (&parser->pdata);
+  zik_xml_tokenizer_init (&parser->tok, NULL, 0);
+  parser->fed = 0;
+  parser->res = zik_message_strict_xml ? ZIK_XML_UNSUPPORTED : ZIK_XML_AGAIN;
+  g_clear_error (&parser->error);
+}
+
+/* parse what is new in @payload, all of answer payload received so far.
+ * It may have moved since previous call but bytes already given must be
+ * unchanged, they are not copied */
+void
+zik_reply_parser_feed (ZikReplyParser * parser, const gchar * payload,
+    gsize size)
+{
+  ZikXmlTokenizer *tok = &parser->tok;
+  gsize start;
+
+  if (size <= parser->fed)
+    return;
+
+  start = MAX (parser->fed, ZIK_REPLY_PREAMBLE_LEN);
+  parser->fed = size;
+
+  if (parser->res != ZIK_XML_AGAIN || size <= start)
+    return;
+
+  /* strings of tags are NUL terminated once copied */
+  if (memchr (payload + start, '\0', size - start)) {
+    parser->res = ZIK_XML_UNSUPPORTED;
+    return;
+  }
+
+  tok->input = payload + ZIK_REPLY_PREAMBLE_LEN;
+  tok->size = size - ZIK_REPLY_PREAMBLE_LEN;
+
+  /* no tag can be complete without it, don't scan pending one again */
+  if (memchr (payload + start, '>', size - start) == NULL)
+    return;
+
+  parser->res = zik_xml_tokenize (tok, &parser->pdata, &parser->error);
+}
+
+/* complete parsing with @answer, the full message. What has been fed is
+ * its beginning, only the rest of it is parsed */
+static gboolean
+zik_reply_parser_finish (ZikReplyParser * parser, ZikMessage * answer)
+{
+  g_return_val_if_fail (zik_message_is_request (answer), FALSE);
+
+  if (parser->fed > answer->payload_size)
+    zik_reply_parser_reset (parser);
+
+  zik_reply_parser_feed (parser, answer->payload, answer->payload_size);
+
+  if (parser->res == ZIK_XML_AGAIN)
+    parser->res = zik_xml_tokenizer_end (&parser->tok);
+
+  switch (parser->res) {
+    case ZIK_XML_OK:
+      return TRUE;
+    case ZIK_XML_ERROR:
+      g_critical ("failed to parse request reply: %s",
+          parser->error->message);
+      zik_parser_data_clear (&parser->pdata);
+      return FALSE;
+    default:
+      /* start again with GMarkup */
+      zik_parser_data_reset (&parser->pdata);
+      return zik_message_parse_answer_markup (answer, &parser->pdata);
+  }
+}
+
+gboolean
+zik_reply_parser_finish_reply (ZikReplyParser * parser, ZikMessage * answer,
+    ZikRequestReplyData ** reply)
+{
+  g_return_val_if_fail (parser->pdata.target == NULL, FALSE);
+
+  if (!zik_reply_parser_finish (parser, answer))
+    return FALSE;
+
+  *reply = parser->pdata.reply;
+  parser->pdata.reply = NULL;
+  return TRUE;
+}
+
+/* see zik_message_parse_request_reply_info() */
+gboolean
+zik_reply_parser_finish_info (ZikReplyParser * parser, ZikMessage * answer,
+    gpointer * info, gboolean * error)
+{
+  g_return_val_if_fail (parser->pdata.target != NULL, FALSE);
+
+  if (!zik_reply_parser_finish (parser, answer))
+    return FALSE;
+
+  *info = parser->pdata.info;
+  *error = parser->pdata.error;
+  parser->pdata.info = NULL;
+  return TRUE;
+}
+
+/* Return: (transfer none): xml of request reply, not nul-terminated */
+const gchar *
+zik_message_peek_request_reply_xml (ZikMessage * msg, gsize * size)
+{
+  g_return_val_if_fail (zik_message_is_request (msg), NULL);
+
+  if (msg->payload_size < 4)
+    return NULL;
+
+  *size = msg->payload_size - 4;
+  return msg->payload + 4;
 }
 
 gchar *
@@ -658,69 +1780,283 @@ zik_message_get_request_reply_xml (ZikMessage * msg)
   return g_strndup (xml, xml_size);
 }
 
-/** ZikRequestReplyData API */
-static gboolean
-zik_request_reply_data_free_node (GNode * node, gpointer userdata)
+/** ZikMessageDecoder API
+ *
+ * Accumulate bytes received from the stream and cut them into messages,
+ * whatever the way they were split or merged by reads.
+ *
+ * Popped messages point in decoder slab rather than having their payload
+ * copied. Once there is not enough room left for a full message, payloads
+ * of those still alive are copied out and the slab is rewound, as it is
+ * when decoder is freed. A connection thus holds a single slab and a
+ * message kept for long only costs its payload. Messages have to be freed
+ * from the thread using their decoder */
+
+ZikMessageDecoder *
+zik_message_decoder_new (void)
 {
-  /* first field of node data is a GType */
-  GType *type = (GType *) node->data;
+  ZikMessageDecoder *dec;
 
-  g_boxed_free (*type, node->data);
+  dec = g_slice_new0 (ZikMessageDecoder);
+  dec->slab = g_malloc (ZIK_MESSAGE_SLAB_SIZE);
+  g_queue_init (&dec->messages);
 
-  /* don't stop traversal */
-  return FALSE;
+  return dec;
+}
+
+/* give their own copy of payload to messages pointing in slab */
+static void
+zik_message_decoder_detach_messages (ZikMessageDecoder * dec)
+{
+  GList *link;
+
+  while ((link = g_queue_pop_head_link (&dec->messages))) {
+    ZikMessage *msg = link->data;
+
+    msg->payload = g_memdup (msg->payload, msg->payload_size);
+    msg->decoder = NULL;
+  }
 }
 
 void
-zik_request_reply_data_free (ZikRequestReplyData * reply)
+zik_message_decoder_free (ZikMessageDecoder * dec)
 {
-  g_node_traverse (reply->root, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
-      zik_request_reply_data_free_node, NULL);
-  g_node_destroy (reply->root);
-  g_slice_free (ZikRequestReplyData, reply);
+  zik_message_decoder_detach_messages (dec);
+  g_free (dec->slab);
+  g_slice_free (ZikMessageDecoder, dec);
 }
 
-typedef struct
+/* Return: (transfer none): where to write received bytes, at least enough
+ * room to complete a pending message. Call zik_message_decoder_commit()
+ * with the number of bytes written */
+guint8 *
+zik_message_decoder_get_buffer (ZikMessageDecoder * dec, gsize * size)
 {
-  GType type;
-  GNode *result;
-} FindNodeFuncData;
+  if (ZIK_MESSAGE_SLAB_SIZE - dec->end < G_MAXUINT16)
+    zik_message_decoder_detach_messages (dec);
+
+  /* slab can't be rewound under messages pointing in it */
+  if (g_queue_is_empty (&dec->messages)) {
+    if (dec->start == dec->end) {
+      dec->start = dec->end = 0;
+    } else if (ZIK_MESSAGE_SLAB_SIZE - dec->end < G_MAXUINT16) {
+      memmove (dec->slab, dec->slab + dec->start, dec->end - dec->start);
+      dec->end -= dec->start;
+      dec->start = 0;
+    }
+  }
 
-static gboolean
-zik_request_reply_data_find_node_func (GNode * node, gpointer userdata)
+  *size = ZIK_MESSAGE_SLAB_SIZE - dec->end;
+  return dec->slab + dec->end;
+}
+
+void
+zik_message_decoder_commit (ZikMessageDecoder * dec, gsize size)
 {
-  FindNodeFuncData *data = (FindNodeFuncData *) userdata;
-  GType *type = (GType *) node->data;
+  g_return_if_fail (dec->end + size <= ZIK_MESSAGE_SLAB_SIZE);
+
+  dec->end += size;
+}
 
-  if (*type == data->type) {
-    data->result = node;
-    return TRUE;
+/* copy @size bytes of @data in decoder */
+void
+zik_message_decoder_push (ZikMessageDecoder * dec, const guint8 * data,
+    gsize size)
+{
+  while (size > 0) {
+    guint8 *buf;
+    gsize avail;
+
+    buf = zik_message_decoder_get_buffer (dec, &avail);
+    avail = MIN (avail, size);
+    memcpy (buf, data, avail);
+    zik_message_decoder_commit (dec, avail);
+
+    data += avail;
+    size -= avail;
   }
+}
 
-  /* continue traverse */
-  return FALSE;
+/* Return: (transfer none): payload received so far of the next message if
+ * it is a request reply, complete or not, NULL otherwise */
+const gchar *
+zik_message_decoder_peek_request_payload (ZikMessageDecoder * dec,
+    gsize * size)
+{
+  const guint8 *data;
+  gsize msg_size;
+
+  if (dec->end - dec->start < ZIK_MESSAGE_HEADER_LEN)
+    return NULL;
+
+  data = dec->slab + dec->start;
+  if (data[2] != ZIK_MESSAGE_ID_REQ)
+    return NULL;
+
+  msg_size = zik_message_read_size (data);
+  if (msg_size < ZIK_MESSAGE_HEADER_LEN)
+    return NULL;
+
+  *size = MIN (dec->end - dec->start, msg_size) - ZIK_MESSAGE_HEADER_LEN;
+  return (const gchar *) data + ZIK_MESSAGE_HEADER_LEN;
 }
 
-/* transfer none */
+/* Return: (transfer full): next complete message, or NULL if more bytes are
+ * needed or if @error is set because stream is corrupted. Message payload
+ * is kept in decoder slab for as long as there is room */
+ZikMessage *
+zik_message_decoder_pop (ZikMessageDecoder * dec, GError ** error)
+{
+  ZikMessage *msg;
+  const guint8 *data;
+  gsize msg_size;
+
+  if (dec->end - dec->start < ZIK_MESSAGE_HEADER_LEN)
+    return NULL;
+
+  data = dec->slab + dec->start;
+  msg_size = zik_message_read_size (data);
+
+  if (msg_size < ZIK_MESSAGE_HEADER_LEN) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        "bad message size in stream: %" G_GSIZE_FORMAT, msg_size);
+    return NULL;
+  }
+
+  if (dec->end - dec->start < msg_size)
+    return NULL;
+
+  msg = g_slice_new0 (ZikMessage);
+  msg->id = data[2];
+  msg->payload_size = msg_size - ZIK_MESSAGE_HEADER_LEN;
+  msg->payload = (gchar *) data + ZIK_MESSAGE_HEADER_LEN;
+  msg->decoder = dec;
+  msg->link.data = msg;
+  g_queue_push_tail_link (&dec->messages, &msg->link);
+
+  dec->start += msg_size;
+
+  return msg;
+}
+
+/** ZikRequestReplyData API */
+
+/* free reply along with all its infos */
+void
+zik_request_reply_data_free (ZikRequestReplyData * reply)
+{
+  ZikReplyChunk *chunk = reply->chunks;
+
+  /* memory is kept until stolen infos are released too */
+  if (!g_atomic_int_dec_and_test (&reply->ref_count))
+    return;
+
+  /* reply is in the last chunk */
+  while (chunk) {
+    ZikReplyChunk *next = chunk->next;
+
+    g_free (chunk);
+    chunk = next;
+  }
+}
+
+/* Return: (transfer none): first info of @type, owned by @reply hence not
+ * refcounted. Use zik_request_reply_data_steal_node_info() or
+ * zik_request_reply_data_copy_info() to keep it */
 gpointer
 zik_request_reply_data_find_node_info (ZikRequestReplyData * reply,
     GType type)
 {
-  GNode *node;
-  FindNodeFuncData data;
+  const ZikElementSpec *spec;
+  ZikReplyNode *node;
 
-  memset (&data, 0, sizeof (data));
-  data.type = type;
+  spec = zik_element_spec_for_type (type);
+  g_return_val_if_fail (spec != NULL, NULL);
 
-  g_node_traverse (reply->root, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
-      zik_request_reply_data_find_node_func, &data);
+  node = reply->first[spec->id];
+  if (node == NULL)
+    return NULL;
 
-  node = data.result;
+  return node->info;
+}
 
+/* Return: (transfer none): info of same type following @info in @reply or
+ * NULL if it is the last one */
+gpointer
+zik_request_reply_data_find_next_node_info (ZikRequestReplyData * reply,
+    gpointer info)
+{
+  ZikReplyNode *node = (ZikReplyNode *) info - 1;
+
+  g_return_val_if_fail (node->info == info, NULL);
+
+  if (node->next_same == NULL)
+    return NULL;
+
+  return node->next_same->info;
+}
+
+/* Return: (transfer full): copy of first info of @type outliving @reply */
+gpointer
+zik_request_reply_data_copy_info (ZikRequestReplyData * reply, GType type)
+{
+  const ZikElementSpec *spec;
+  gpointer info;
+
+  spec = zik_element_spec_for_type (type);
+  g_return_val_if_fail (spec != NULL, NULL);
+
+  info = zik_request_reply_data_find_node_info (reply, type);
+  if (info == NULL)
+    return NULL;
+
+  return zik_element_copy_info (spec, info);
+}
+
+/* Remove first info of @type from @reply and hand it over without copy. It
+ * stays in the memory of @reply which is only freed once the info is
+ * released as well, so zik_request_reply_data_copy_info() is preferable for
+ * a small info kept long after a large reply.
+ * Return: (transfer full): refcounted info or NULL if there is none */
+gpointer
+zik_request_reply_data_steal_node_info (ZikRequestReplyData * reply,
+    GType type)
+{
+  const ZikElementSpec *spec;
+  ZikReplyNode *node;
+  ZikInfoHeader *info;
+
+  spec = zik_element_spec_for_type (type);
+  g_return_val_if_fail (spec != NULL, NULL);
+  g_return_val_if_fail (spec->id != ZIK_ELEMENT_ANSWER, NULL);
+
+  node = reply->first[spec->id];
   if (node == NULL)
     return NULL;
 
-  return node->data;
+  reply->first[spec->id] = node->next_same;
+  if (reply->last[spec->id] == node)
+    reply->last[spec->id] = NULL;
+  node->next_same = NULL;
+
+  g_atomic_int_inc (&reply->ref_count);
+  node->reply = reply;
+
+  info = node->info;
+  info->ref_count = 1;
+  info->in_reply = TRUE;
+
+  return info;
+}
+
+void
+zik_request_reply_data_release_info (gpointer info)
+{
+  ZikReplyNode *node = (ZikReplyNode *) info - 1;
+
+  g_return_if_fail (node->info == info && node->reply != NULL);
+
+  zik_request_reply_data_free (node->reply);
 }
 
 gboolean
@@ -730,7 +2066,7 @@ zik_request_reply_data_error (ZikRequestReplyData * reply)
 
   g_return_val_if_fail (reply != NULL, FALSE);
   g_return_val_if_fail (reply->root != NULL, FALSE);
-  info = reply->root->data;
+  info = reply->root->info;
   g_return_val_if_fail (info->itype == ZIK_ANSWER_INFO_TYPE, FALSE);
 
   return info->error;
@@ -23,29 +23,81 @@
 
 G_BEGIN_DECLS
 
+/* uint16_t size in network byte order followed by uint8_t message id */
+#define ZIK_MESSAGE_HEADER_LEN 3
+
 typedef struct _ZikMessage ZikMessage;
+typedef struct _ZikMessageDecoder ZikMessageDecoder;
 typedef struct _ZikRequestReplyData ZikRequestReplyData;
+typedef struct _ZikReplyParser ZikReplyParser;
 
 void zik_message_free (ZikMessage * msg);
+ZikMessage *zik_message_copy (ZikMessage * msg);
 
 ZikMessage *zik_message_new_from_buffer (const guint8 * data, gsize size);
 guint8 *zik_message_make_buffer (ZikMessage * msg, gsize *out_size);
+gboolean zik_message_write_header (ZikMessage * msg, guint8 * header);
+const gchar *zik_message_peek_payload (ZikMessage * msg, gsize * size);
 
 ZikMessage *zik_message_new_open_session (void);
 ZikMessage *zik_message_new_close_session (void);
 
+gboolean zik_message_is_open_session (ZikMessage * msg);
+gboolean zik_message_is_close_session (ZikMessage * msg);
+
+ZikMessage *zik_message_new_acknowledge (void);
 gboolean zik_message_is_acknowledge (ZikMessage * msg);
 
 ZikMessage *zik_message_new_request (const gchar * path, const gchar * method,
     const gchar * args);
 gboolean zik_message_is_request (ZikMessage * msg);
+const gchar *zik_message_peek_request_path (ZikMessage * msg, gsize * len);
+const gchar *zik_message_peek_request_args (ZikMessage * msg, gsize * len);
+const gchar *zik_message_peek_request_reply_path (ZikMessage * msg,
+    gsize * len);
+
+ZikMessage *zik_message_new_request_reply (const gchar * xml,
+    gsize xml_size);
+void zik_message_set_strict_xml (gboolean strict);
 gboolean zik_message_parse_request_reply (ZikMessage * msg,
     ZikRequestReplyData ** reply);
+gboolean zik_message_parse_request_reply_info (ZikMessage * msg, GType type,
+    gpointer * info, gboolean * error);
+const gchar *zik_message_peek_request_reply_xml (ZikMessage * msg,
+    gsize * size);
 gchar *zik_message_get_request_reply_xml (ZikMessage * msg);
 
+ZikMessageDecoder *zik_message_decoder_new (void);
+void zik_message_decoder_free (ZikMessageDecoder * dec);
+guint8 *zik_message_decoder_get_buffer (ZikMessageDecoder * dec,
+    gsize * size);
+void zik_message_decoder_commit (ZikMessageDecoder * dec, gsize size);
+void zik_message_decoder_push (ZikMessageDecoder * dec, const guint8 * data,
+    gsize size);
+const gchar *zik_message_decoder_peek_request_payload (
+    ZikMessageDecoder * dec, gsize * size);
+ZikMessage *zik_message_decoder_pop (ZikMessageDecoder * dec,
+    GError ** error);
+
+ZikReplyParser *zik_reply_parser_new (GType type);
+void zik_reply_parser_free (ZikReplyParser * parser);
+void zik_reply_parser_reset (ZikReplyParser * parser);
+void zik_reply_parser_feed (ZikReplyParser * parser, const gchar * payload,
+    gsize size);
+gboolean zik_reply_parser_finish_reply (ZikReplyParser * parser,
+    ZikMessage * answer, ZikRequestReplyData ** reply);
+gboolean zik_reply_parser_finish_info (ZikReplyParser * parser,
+    ZikMessage * answer, gpointer * info, gboolean * error);
+
 void zik_request_reply_data_free (ZikRequestReplyData * reply_data);
 gpointer zik_request_reply_data_find_node_info (ZikRequestReplyData * reply,
     GType type);
+gpointer zik_request_reply_data_find_next_node_info (
+    ZikRequestReplyData * reply, gpointer info);
+gpointer zik_request_reply_data_steal_node_info (ZikRequestReplyData * reply,
+    GType type);
+gpointer zik_request_reply_data_copy_info (ZikRequestReplyData * reply,
+    GType type);
 gboolean zik_request_reply_data_error (ZikRequestReplyData * reply);
 
 G_END_DECLS
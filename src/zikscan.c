@@ -0,0 +1,190 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Delimiter scanning for answer parsing, vectorized on x86 where the best
+ * kernel supported by the CPU is picked on first use */
+
+#include "zikscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ZIK_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef const gchar *(*ZikScanFunc) (const gchar * p, const gchar * end,
+    gchar a, gchar b, gchar c);
+
+static const gchar *
+zik_scan3_scalar (const gchar * p, const gchar * end, gchar a, gchar b,
+    gchar c)
+{
+  for (; p < end; p++) {
+    if (*p == a || *p == b || *p == c)
+      return p;
+  }
+
+  return end;
+}
+
+#ifdef ZIK_SCAN_X86
+
+__attribute__ ((target ("sse2")))
+static const gchar *
+zik_scan3_sse2 (const gchar * p, const gchar * end, gchar a, gchar b, gchar c)
+{
+  const __m128i va = _mm_set1_epi8 (a);
+  const __m128i vb = _mm_set1_epi8 (b);
+  const __m128i vc = _mm_set1_epi8 (c);
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) p);
+    __m128i eq = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, va),
+            _mm_cmpeq_epi8 (v, vb)), _mm_cmpeq_epi8 (v, vc));
+    gint mask = _mm_movemask_epi8 (eq);
+
+    if (mask)
+      return p + __builtin_ctz (mask);
+
+    p += 16;
+  }
+
+  return zik_scan3_scalar (p, end, a, b, c);
+}
+
+__attribute__ ((target ("avx2")))
+static const gchar *
+zik_scan3_avx2 (const gchar * p, const gchar * end, gchar a, gchar b, gchar c)
+{
+  const __m256i va = _mm256_set1_epi8 (a);
+  const __m256i vb = _mm256_set1_epi8 (b);
+  const __m256i vc = _mm256_set1_epi8 (c);
+
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256 ((const __m256i *) p);
+    __m256i eq = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v, va),
+            _mm256_cmpeq_epi8 (v, vb)), _mm256_cmpeq_epi8 (v, vc));
+    guint mask = _mm256_movemask_epi8 (eq);
+
+    if (mask)
+      return p + __builtin_ctz (mask);
+
+    p += 32;
+  }
+
+  /* non VEX SSE2 code is much slower while upper halves are dirty, GCC
+   * doesn't always clear them before a tail call */
+  _mm256_zeroupper ();
+
+  return zik_scan3_sse2 (p, end, a, b, c);
+}
+
+#endif
+
+typedef struct
+{
+  const gchar *name;
+  ZikScanFunc func;
+} ZikScanKernel;
+
+/* best first */
+static const ZikScanKernel zik_scan_kernels[] = {
+#ifdef ZIK_SCAN_X86
+  { "avx2", zik_scan3_avx2 },
+  { "sse2", zik_scan3_sse2 },
+#endif
+  { "scalar", zik_scan3_scalar },
+};
+
+static ZikScanFunc zik_scan3_func = NULL;
+static const gchar *zik_scan_implementation = NULL;
+
+static gboolean
+zik_scan_kernel_supported (const ZikScanKernel * kernel)
+{
+#ifdef ZIK_SCAN_X86
+  __builtin_cpu_init ();
+  if (kernel->func == zik_scan3_avx2)
+    return __builtin_cpu_supports ("avx2");
+  if (kernel->func == zik_scan3_sse2)
+    return __builtin_cpu_supports ("sse2");
+#endif
+
+  return TRUE;
+}
+
+static void
+zik_scan_init (void)
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    guint i;
+
+    for (i = 0; !zik_scan_kernel_supported (&zik_scan_kernels[i]); i++);
+
+    zik_scan3_func = zik_scan_kernels[i].func;
+    zik_scan_implementation = zik_scan_kernels[i].name;
+
+    g_once_init_leave (&init, 1);
+  }
+}
+
+/* Return: first byte of [@p, @end) equal to @a, @b or @c, @end if none */
+const gchar *
+zik_scan3 (const gchar * p, const gchar * end, gchar a, gchar b, gchar c)
+{
+  if (G_UNLIKELY (zik_scan3_func == NULL))
+    zik_scan_init ();
+
+  return zik_scan3_func (p, end, a, b, c);
+}
+
+/* Return: name of kernel in use, for debugging */
+const gchar *
+zik_scan_get_implementation (void)
+{
+  zik_scan_init ();
+
+  return zik_scan_implementation;
+}
+
+/* Use kernel @name instead of the best one, for debugging and benchmarks.
+ * It isn't thread safe, call it while nothing is being parsed.
+ * Return: FALSE if there is no such kernel or CPU doesn't support it */
+gboolean
+zik_scan_set_implementation (const gchar * name)
+{
+  guint i;
+
+  zik_scan_init ();
+
+  for (i = 0; i < G_N_ELEMENTS (zik_scan_kernels); i++) {
+    const ZikScanKernel *kernel = &zik_scan_kernels[i];
+
+    if (g_strcmp0 (kernel->name, name) != 0)
+      continue;
+
+    if (!zik_scan_kernel_supported (kernel))
+      return FALSE;
+
+    zik_scan3_func = kernel->func;
+    zik_scan_implementation = kernel->name;
+    return TRUE;
+  }
+
+  return FALSE;
+}
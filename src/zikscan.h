@@ -0,0 +1,32 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIK_SCAN_H
+#define ZIK_SCAN_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+const gchar *zik_scan3 (const gchar * p, const gchar * end, gchar a, gchar b,
+    gchar c);
+const gchar *zik_scan_get_implementation (void);
+gboolean zik_scan_set_implementation (const gchar * name);
+
+G_END_DECLS
+
+#endif
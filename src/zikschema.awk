@@ -0,0 +1,623 @@
+# Zik2ctl
+# Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+#
+# Zik2ctl is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Zik2ctl is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+
+# Generate protocol enumerations and their codecs, info structures, element
+# table, element lookup and API path registry from zikschema.def, see its
+# header for the syntax.
+#
+# usage: awk -v header=zikschema.h -v source=zikschema.c -f zikschema.awk \
+#          zikschema.def
+
+function fail(msg)
+{
+  printf ("%s:%d: %s\n", FILENAME, FNR, msg) > "/dev/stderr"
+  failed = 1
+  exit 1
+}
+
+# print "start (p1, p2...)end" to file, wrapped at 80 columns
+function print_wrapped(file, start, params, n, end,    line, i, item)
+{
+  line = start "("
+  for (i = 1; i <= n; i++) {
+    item = params[i] (i < n ? "," : ")" end)
+    if (i > 1 && length (line) + 1 + length (item) > 79) {
+      print line > file
+      line = "    " item
+    } else {
+      line = line (i > 1 ? " " : "") item
+    }
+  }
+  if (n == 0)
+    line = line "void)" end
+  print line > file
+}
+
+# "ZikNoiseControlMode" => "zik_noise_control_mode"
+function snake_case(type,    out, i, c)
+{
+  out = ""
+  for (i = 1; i <= length (type); i++) {
+    c = substr (type, i, 1)
+    if (i > 1 && c ~ /[A-Z]/)
+      out = out "_"
+    out = out tolower (c)
+  }
+  return out
+}
+
+# print a switch on value returning the names or wire forms of values of e
+function print_enum_switch(file, e, table,    v)
+{
+  print "  switch (value) {" > file
+  for (v = 1; v <= enum_n_values[e]; v++) {
+    print "    case " enum_const[e, v] ":" > file
+    print "      return \"" (table == "names" ? enum_vname[e, v] : \
+        enum_wire[e, v]) "\";" > file
+  }
+  print "  }" > file
+  print "" > file
+  print "  return NULL;" > file
+}
+
+function attr_ctype(n, a)
+{
+  if (attr_type[n, a] == "enum")
+    return enum_type[attr_enum[n, a]] " "
+  return ctype[attr_type[n, a]]
+}
+
+BEGIN {
+  n_enums = 0
+  n_elements = 0
+  n_paths = 0
+  ctype["string"] = "gchar *"
+  ctype["boolean"] = "gboolean "
+  ctype["int"] = "guint "
+  ctype["interned"] = "const gchar *"
+  atype["string"] = "ZIK_ATTR_STRING"
+  atype["interned"] = "ZIK_ATTR_INTERNED"
+  atype["boolean"] = "ZIK_ATTR_BOOLEAN"
+  atype["int"] = "ZIK_ATTR_INT"
+  atype["ignored"] = "ZIK_ATTR_IGNORED"
+  atype["enum"] = "ZIK_ATTR_ENUM"
+  # keep in sync with ZIK_ATTR_MAX
+  attr_max = 5
+}
+
+/^[ \t]*(#|$)/ {
+  next
+}
+
+$1 == "enum" && NF == 3 {
+  if ($2 in enum_index)
+    fail("enum '" $2 "' defined twice")
+
+  e = ++n_enums
+  enum_index[$2] = e
+  enum_type[e] = $2
+  enum_prefix[e] = snake_case($2)
+  enum_unknown[e] = "-1"
+  enum_n_values[e] = split ($3, enum_values, ",")
+
+  for (v = 1; v <= enum_n_values[e]; v++) {
+    if (split (enum_values[v], parts, "=") > 2)
+      fail("expected name[=wire] for value '" enum_values[v] "'")
+    wire = (2 in parts) ? parts[2] : parts[1]
+    vname = enum_values[v]
+    sub (/=.*/, "", vname)
+    if (vname !~ /^[a-z0-9_]+$/ || wire !~ /^[a-z0-9_]+$/)
+      fail("invalid value '" enum_values[v] "' of enum '" $2 "'")
+
+    number = (wire ~ /^[0-9]+$/) ? wire + 0 : v - 1
+    if ((e, number) in enum_numbers)
+      fail("value " number " given twice in enum '" $2 "'")
+    enum_numbers[e, number] = 1
+
+    enum_vname[e, v] = vname
+    enum_wire[e, v] = wire
+    enum_number[e, v] = number
+    enum_const[e, v] = toupper (enum_prefix[e] "_" vname)
+    if (vname == "unknown")
+      enum_unknown[e] = enum_const[e, v]
+  }
+  next
+}
+
+$1 == "element" {
+  if (NF != 4)
+    fail("expected: element <name> <parent> <TypeName>")
+  if ($2 in element_index)
+    fail("element '" $2 "' defined twice")
+  if ($3 != "-" && $3 != "*" && !($3 in element_index))
+    fail("parent '" $3 "' of '" $2 "' is not defined before it")
+
+  n = ++n_elements
+  element_index[$2] = n
+  name[n] = $2
+  parent[n] = $3
+  info_type[n] = "Zik" $4 "Info"
+  prefix[n] = "zik_" $2 "_info"
+  id[n] = "ZIK_ELEMENT_" toupper ($2)
+  n_attrs[n] = 0
+  next
+}
+
+$1 in atype {
+  if (n_elements == 0)
+    fail("attribute outside of element")
+
+  n = n_elements
+  a = ++n_attrs[n]
+  if (a > attr_max)
+    fail("element '" name[n] "' has more than " attr_max " attributes")
+
+  attr_name[n, a] = $2
+  attr_type[n, a] = $1
+  attr_field[n, a] = $2
+  attr_optional[n, a] = "FALSE"
+  attr_values[n, a] = ""
+  attr_enum[n, a] = ""
+
+  for (i = 3; i <= NF; i++) {
+    if ($i == "as" && i < NF)
+      attr_field[n, a] = $(++i)
+    else if ($i == "of" && i < NF && $1 == "interned")
+      attr_values[n, a] = $(++i)
+    else if ($i == "of" && i < NF && $1 == "enum") {
+      if (!($(++i) in enum_index))
+        fail("enum '" $i "' is not defined before '" $2 "'")
+      attr_enum[n, a] = enum_index[$i]
+    } else if ($i == "optional")
+      attr_optional[n, a] = "TRUE"
+    else
+      fail("unexpected '" $i "' for attribute '" $2 "'")
+  }
+  if ($1 == "enum" && attr_enum[n, a] == "")
+    fail("expected: enum <attribute> of <TypeName>")
+  next
+}
+
+$1 == "path" {
+  if (NF != 4 && !(NF == 5 && $5 == "get"))
+    fail("expected: path <NAME> <path> <models> [get]")
+
+  if ($3 in path_index)
+    fail("path '" $3 "' defined twice")
+
+  n = ++n_paths
+  path_index[$3] = n
+  path_name[n] = "ZIK_API_" $2 "_PATH"
+  path_id[n] = "ZIK_API_PATH_" $2
+  path_value[n] = $3
+  path_get[n] = (NF == 5) ? "TRUE" : "FALSE"
+
+  nm = split ($4, models, ",")
+  path_models[n] = ""
+  for (i = 1; i <= nm; i++) {
+    if (models[i] != "zik2" && models[i] != "zik3")
+      fail("unknown model '" models[i] "'")
+    path_models[n] = path_models[n] (i > 1 ? " | " : "") \
+        "ZIK_MODEL_" toupper (models[i])
+  }
+  next
+}
+
+{
+  fail("unexpected '" $1 "'")
+}
+
+END {
+  if (failed)
+    exit 1
+
+  generated = "/* generated by zikschema.awk from zikschema.def, do not edit */"
+
+  # header
+  print generated > header
+  print "" > header
+  print "#ifndef ZIK_SCHEMA_H" > header
+  print "#define ZIK_SCHEMA_H" > header
+  print "" > header
+  print "#include <glib.h>" > header
+  print "#include <glib-object.h>" > header
+  print "" > header
+  print "G_BEGIN_DECLS" > header
+  print "" > header
+
+  for (e = 1; e <= n_enums; e++) {
+    print "typedef enum" > header
+    print "{" > header
+    for (v = 1; v <= enum_n_values[e]; v++)
+      printf ("  %s = %d%s\n", enum_const[e, v], enum_number[e, v],
+          v < enum_n_values[e] ? "," : "") > header
+    print "} " enum_type[e] ";" > header
+    print "" > header
+  }
+
+  print "/* codecs from and to wire forms, names are the ones of constants */" \
+      > header
+  for (e = 1; e <= n_enums; e++) {
+    params[1] = "const gchar * str"
+    params[2] = enum_type[e] " * value"
+    print_wrapped(header, "gboolean " enum_prefix[e] "_from_string ", params,
+        2, ";")
+    params[1] = enum_type[e] " value"
+    print_wrapped(header, "const gchar *" enum_prefix[e] "_to_string ",
+        params, 1, ";")
+    print_wrapped(header, "const gchar *" enum_prefix[e] "_get_name ",
+        params, 1, ";")
+    print "" > header
+  }
+
+  print "typedef enum" > header
+  print "{" > header
+  print "  ZIK_ELEMENT_UNKNOWN = 0," > header
+  print "  /* parent of top-level element */" > header
+  print "  ZIK_ELEMENT_NONE," > header
+  print "  /* any known element as parent */" > header
+  print "  ZIK_ELEMENT_ANY," > header
+  print "" > header
+  for (n = 1; n <= n_elements; n++)
+    print "  " id[n] "," > header
+  print "" > header
+  print "  ZIK_N_ELEMENTS" > header
+  print "} ZikElementId;" > header
+  print "" > header
+
+  for (n = 1; n <= n_elements; n++)
+    printf ("#define %s (%s_get_type ())\n", toupper (prefix[n]) "_TYPE",
+        prefix[n]) > header
+  print "" > header
+
+  for (n = 1; n <= n_elements; n++)
+    printf ("typedef struct _%s %s;\n", info_type[n], info_type[n]) > header
+  print "" > header
+
+  print "/* all info structures begin with ZikInfoHeader fields */" > header
+  for (n = 1; n <= n_elements; n++) {
+    print "struct _" info_type[n] > header
+    print "{" > header
+    print "  GType itype;" > header
+    print "  gint ref_count;" > header
+    print "  gboolean in_reply;" > header
+    first = 1
+    for (a = 1; a <= n_attrs[n]; a++) {
+      if (attr_type[n, a] == "ignored")
+        continue
+      if (first)
+        print "" > header
+      first = 0
+      print "  " attr_ctype(n, a) attr_field[n, a] ";" > header
+    }
+    print "};" > header
+    print "" > header
+  }
+
+  for (n = 1; n <= n_elements; n++) {
+    np = 0
+    for (a = 1; a <= n_attrs[n]; a++) {
+      if (attr_type[n, a] == "string" || attr_type[n, a] == "interned")
+        params[++np] = "const gchar * " attr_field[n, a]
+      else if (attr_type[n, a] != "ignored")
+        params[++np] = attr_ctype(n, a) attr_field[n, a]
+    }
+
+    print "GType " prefix[n] "_get_type (void);" > header
+    print_wrapped(header, info_type[n] " *" prefix[n] "_new ", params, np,
+        ";")
+    print info_type[n] " *" prefix[n] "_ref (" info_type[n] " * info);" \
+        > header
+    print "void " prefix[n] "_unref (" info_type[n] " * info);" > header
+    print "" > header
+  }
+
+  for (n = 1; n <= n_paths; n++)
+    printf ("#define %s \"%s\"\n", path_name[n], path_value[n]) > header
+  print "" > header
+  print "/* index of paths in zik_api_paths */" > header
+  print "typedef enum" > header
+  print "{" > header
+  print "  ZIK_API_PATH_UNKNOWN = -1," > header
+  print "" > header
+  for (n = 1; n <= n_paths; n++)
+    print "  " path_id[n] "," > header
+  print "" > header
+  print "  ZIK_N_API_PATHS" > header
+  print "} ZikApiPathId;" > header
+  print "" > header
+  print "G_END_DECLS" > header
+  print "" > header
+  print "#endif" > header
+
+  # source
+  print generated > source
+  print "" > source
+  print "#include <string.h>" > source
+  print "" > source
+  print "#include \"zikinfo.h\"" > source
+  print "#include \"zikapi.h\"" > source
+  print "" > source
+
+  for (e = 1; e <= n_enums; e++) {
+    # values grouped by first letter of their wire form
+    n_letters = 0
+    delete letters
+    delete letter_values
+    for (v = 1; v <= enum_n_values[e]; v++) {
+      c = substr (enum_wire[e, v], 1, 1)
+      if (!(c in letter_values)) {
+        letters[++n_letters] = c
+        letter_values[c] = ""
+      }
+      letter_values[c] = letter_values[c] " " v
+    }
+
+    print "/* Return: value of @str, -1 if not known */" > source
+    print "static gint" > source
+    print enum_prefix[e] "_decode (const gchar * str)" > source
+    print "{" > source
+    print "  switch (str[0]) {" > source
+    for (l = 1; l <= n_letters; l++) {
+      print "    case '" letters[l] "':" > source
+      nl = split (letter_values[letters[l]], lv, " ")
+      for (i = 1; i <= nl; i++) {
+        v = lv[i]
+        print "      if (strcmp (str, \"" enum_wire[e, v] "\") == 0)" > source
+        print "        return " enum_const[e, v] ";" > source
+      }
+      print "      break;" > source
+    }
+    print "    default:" > source
+    print "      break;" > source
+    print "  }" > source
+    print "" > source
+    print "  return " enum_unknown[e] ";" > source
+    print "}" > source
+    print "" > source
+
+    print "gboolean" > source
+    params[1] = "const gchar * str"
+    params[2] = enum_type[e] " * value"
+    print_wrapped(source, enum_prefix[e] "_from_string ", params, 2, "")
+    print "{" > source
+    print "  gint ret;" > source
+    print "" > source
+    print "  ret = " enum_prefix[e] "_decode (str);" > source
+    print "  if (ret < 0)" > source
+    print "    return FALSE;" > source
+    print "" > source
+    print "  *value = ret;" > source
+    print "  return TRUE;" > source
+    print "}" > source
+    print "" > source
+
+    print "const gchar *" > source
+    print enum_prefix[e] "_to_string (" enum_type[e] " value)" > source
+    print "{" > source
+    print_enum_switch(source, e, "wires")
+    print "}" > source
+    print "" > source
+
+    print "const gchar *" > source
+    print enum_prefix[e] "_get_name (" enum_type[e] " value)" > source
+    print "{" > source
+    print_enum_switch(source, e, "names")
+    print "}" > source
+    print "" > source
+  }
+
+  print "#define ZIK_DEFINE_BOXED_TYPE(TypeName, type_name) \\" > source
+  print "  G_DEFINE_BOXED_TYPE (TypeName, type_name, type_name##_ref, " \
+      "type_name##_unref)" > source
+  print "" > source
+  for (n = 1; n <= n_elements; n++)
+    printf ("ZIK_DEFINE_BOXED_TYPE (%s, %s);\n", info_type[n], prefix[n]) \
+        > source
+  print "" > source
+
+  for (n = 1; n <= n_elements; n++) {
+    for (a = 1; a <= n_attrs[n]; a++) {
+      if (attr_values[n, a] == "")
+        continue
+      nv = split (attr_values[n, a], values, ",")
+      printf ("static const gchar *const %s_%s_values[] = {\n  ", prefix[n],
+          attr_name[n, a]) > source
+      for (v = 1; v <= nv; v++)
+        printf ("\"%s\", ", values[v]) > source
+      print "NULL" > source
+      print "};" > source
+      print "" > source
+    }
+  }
+
+  print "const ZikElementSpec zik_element_specs[ZIK_N_ELEMENTS] = {" > source
+  for (n = 1; n <= n_elements; n++) {
+    if (parent[n] == "-")
+      parent_id = "ZIK_ELEMENT_NONE"
+    else if (parent[n] == "*")
+      parent_id = "ZIK_ELEMENT_ANY"
+    else
+      parent_id = id[element_index[parent[n]]]
+
+    printf ("  [%s] = { \"%s\", %s, %s,\n", id[n], name[n], id[n],
+        parent_id) > source
+    printf ("    sizeof (%s), %s_get_type,\n", info_type[n], prefix[n]) \
+        > source
+    if (n_attrs[n] == 0) {
+      print "    { { NULL } } }," > source
+      continue
+    }
+    for (a = 1; a <= n_attrs[n]; a++) {
+      if (attr_type[n, a] == "ignored")
+        offset = "-1"
+      else
+        offset = "G_STRUCT_OFFSET (" info_type[n] ", " attr_field[n, a] ")"
+      if (attr_values[n, a] != "")
+        offset = offset ",\n        " prefix[n] "_" attr_name[n, a] "_values"
+      else if (attr_type[n, a] == "enum")
+        offset = offset ",\n        NULL, " enum_prefix[attr_enum[n, a]] \
+            "_decode"
+      printf ("    %s{ \"%s\", %s, %s,\n        %s }%s\n",
+          a == 1 ? "{ " : "  ", attr_name[n, a], atype[attr_type[n, a]],
+          attr_optional[n, a], offset,
+          a == n_attrs[n] ? " } }," : ",") > source
+    }
+  }
+  print "};" > source
+  print "" > source
+
+  # elements grouped by first letter, in order of appearance
+  n_letters = 0
+  for (n = 1; n <= n_elements; n++) {
+    c = substr (name[n], 1, 1)
+    if (!(c in letter_elements)) {
+      letters[++n_letters] = c
+      letter_elements[c] = ""
+    }
+    letter_elements[c] = letter_elements[c] " " n
+  }
+
+  print "ZikElementId" > source
+  print "zik_element_lookup (const gchar * name)" > source
+  print "{" > source
+  print "  switch (name[0]) {" > source
+  for (l = 1; l <= n_letters; l++) {
+    print "    case '" letters[l] "':" > source
+    ne = split (letter_elements[letters[l]], elements, " ")
+    for (e = 1; e <= ne; e++) {
+      n = elements[e]
+      print "      if (strcmp (name, \"" name[n] "\") == 0)" > source
+      print "        return " id[n] ";" > source
+    }
+    print "      break;" > source
+  }
+  print "    default:" > source
+  print "      break;" > source
+  print "  }" > source
+  print "" > source
+  print "  return ZIK_ELEMENT_UNKNOWN;" > source
+  print "}" > source
+
+  for (n = 1; n <= n_elements; n++) {
+    np = 0
+    for (a = 1; a <= n_attrs[n]; a++) {
+      if (attr_type[n, a] == "string" || attr_type[n, a] == "interned")
+        params[++np] = "const gchar * " attr_field[n, a]
+      else if (attr_type[n, a] != "ignored")
+        params[++np] = attr_ctype(n, a) attr_field[n, a]
+    }
+
+    print "" > source
+    print info_type[n] " *" > source
+    print_wrapped(source, prefix[n] "_new ", params, np, "")
+    strings = ""
+    has_strings = 0
+    for (a = 1; a <= n_attrs[n]; a++) {
+      f = "NULL"
+      if (attr_type[n, a] == "string" || attr_type[n, a] == "interned") {
+        f = attr_field[n, a]
+        has_strings = 1
+      }
+      strings = strings (a > 1 ? ", " : "") f
+    }
+
+    print "{" > source
+    if (has_strings)
+      print "  const gchar *strings[ZIK_ATTR_MAX] = { " strings " };" > source
+    print "  " info_type[n] " *info;" > source
+    print "" > source
+    print "  info = zik_info_new (" id[n] ", " \
+        (has_strings ? "strings" : "NULL") ");" > source
+    for (a = 1; a <= n_attrs[n]; a++) {
+      f = attr_field[n, a]
+      if (attr_type[n, a] == "boolean" || attr_type[n, a] == "int" ||
+          attr_type[n, a] == "enum")
+        print "  info->" f " = " f ";" > source
+    }
+    print "  return info;" > source
+    print "}" > source
+    print "" > source
+    print info_type[n] " *" > source
+    print prefix[n] "_ref (" info_type[n] " * info)" > source
+    print "{" > source
+    print "  return zik_info_ref (info, " id[n] ");" > source
+    print "}" > source
+    print "" > source
+    print "void" > source
+    print prefix[n] "_unref (" info_type[n] " * info)" > source
+    print "{" > source
+    print "  zik_info_unref (info, " id[n] ");" > source
+    print "}" > source
+  }
+
+  print "" > source
+  print "const ZikApiPath zik_api_paths[ZIK_N_API_PATHS] = {" > source
+  for (n = 1; n <= n_paths; n++) {
+    printf ("  [%s] = { \"%s\", %s,\n    %s, %s },\n", path_id[n],
+        path_name[n], path_name[n], path_models[n], path_get[n]) > source
+  }
+  print "};" > source
+  print "" > source
+
+  # paths grouped by length, in order of appearance
+  n_lengths = 0
+  for (n = 1; n <= n_paths; n++) {
+    len = length (path_value[n])
+    if (!(len in length_paths)) {
+      lengths[++n_lengths] = len
+      length_paths[len] = ""
+    }
+    length_paths[len] = length_paths[len] " " n
+  }
+
+  print "/* @path is not necessarily nul-terminated */" > source
+  print "ZikApiPathId" > source
+  print "zik_api_path_lookup (const gchar * path, gsize len)" > source
+  print "{" > source
+  print "  switch (len) {" > source
+  for (l = 1; l <= n_lengths; l++) {
+    print "    case " lengths[l] ":" > source
+    np = split (length_paths[lengths[l]], same_length, " ")
+    for (i = 1; i <= np; i++) {
+      n = same_length[i]
+      print "      if (memcmp (path, " path_name[n] ", len) == 0)" > source
+      print "        return " path_id[n] ";" > source
+    }
+    print "      break;" > source
+  }
+  print "    default:" > source
+  print "      break;" > source
+  print "  }" > source
+  print "" > source
+  print "  return ZIK_API_PATH_UNKNOWN;" > source
+  print "}" > source
+  print "" > source
+
+  print "/* @path is followed by the method, as in requests and answers */" \
+      > source
+  print "ZikApiPathId" > source
+  print "zik_api_path_lookup_request (const gchar * path, gsize len)" > source
+  print "{" > source
+  print "  const gchar *method;" > source
+  print "" > source
+  print "  method = g_strrstr_len (path, len, \"/\");" > source
+  print "  if (method == NULL)" > source
+  print "    return ZIK_API_PATH_UNKNOWN;" > source
+  print "" > source
+  print "  return zik_api_path_lookup (path, method - path);" > source
+  print "}" > source
+}
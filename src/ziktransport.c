@@ -0,0 +1,685 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include "ziktransport.h"
+
+G_DEFINE_BOXED_TYPE (ZikTransport, zik_transport, zik_transport_ref,
+    zik_transport_unref);
+
+/* @size: size of backend structure, which begins with a ZikTransport */
+gpointer
+zik_transport_new (const ZikTransportFuncs * funcs, gsize size)
+{
+  ZikTransport *transport;
+
+  g_return_val_if_fail (size >= sizeof (ZikTransport), NULL);
+
+  transport = g_malloc0 (size);
+  transport->funcs = funcs;
+  transport->ref_count = 1;
+
+  return transport;
+}
+
+ZikTransport *
+zik_transport_ref (ZikTransport * transport)
+{
+  g_atomic_int_inc (&transport->ref_count);
+  return transport;
+}
+
+void
+zik_transport_unref (ZikTransport * transport)
+{
+  if (g_atomic_int_dec_and_test (&transport->ref_count)) {
+    if (transport->funcs->finalize)
+      transport->funcs->finalize (transport);
+
+    g_free (transport);
+  }
+}
+
+/* Return: number of bytes sent or -1 on error */
+gssize
+zik_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error)
+{
+  return transport->funcs->send (transport, vectors, n_vectors, error);
+}
+
+/* Return: number of bytes received, 0 if remote closed the stream or -1 on
+ * error */
+gssize
+zik_transport_receive (ZikTransport * transport, guint8 * buffer, gsize size,
+    GError ** error)
+{
+  return transport->funcs->receive (transport, buffer, size, error);
+}
+
+/* Return: (transfer full): a source, not attached yet, calling @func when
+ * @condition is met on @transport */
+GSource *
+zik_transport_create_watch (ZikTransport * transport, GIOCondition condition,
+    ZikTransportWatchFunc func, gpointer userdata, GDestroyNotify notify)
+{
+  return transport->funcs->create_watch (transport, condition, func, userdata,
+      notify);
+}
+
+/* closure of a source calling a ZikTransportWatchFunc for a transport */
+typedef struct
+{
+  ZikTransport *transport;
+  ZikTransportWatchFunc func;
+  gpointer userdata;
+  GDestroyNotify notify;
+} ZikTransportWatch;
+
+static ZikTransportWatch *
+zik_transport_watch_new (ZikTransport * transport, ZikTransportWatchFunc func,
+    gpointer userdata, GDestroyNotify notify)
+{
+  ZikTransportWatch *watch;
+
+  watch = g_slice_new0 (ZikTransportWatch);
+  watch->transport = zik_transport_ref (transport);
+  watch->func = func;
+  watch->userdata = userdata;
+  watch->notify = notify;
+
+  return watch;
+}
+
+static void
+zik_transport_watch_free (ZikTransportWatch * watch)
+{
+  if (watch->notify)
+    watch->notify (watch->userdata);
+
+  zik_transport_unref (watch->transport);
+  g_slice_free (ZikTransportWatch, watch);
+}
+
+
+/** Socket backend, used for RFCOMM link and socketpair */
+
+typedef struct
+{
+  ZikTransport parent;
+
+  GSocket *socket;
+} ZikSocketTransport;
+
+static gssize
+zik_socket_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error)
+{
+  ZikSocketTransport *self = (ZikSocketTransport *) transport;
+
+  return g_socket_send_message (self->socket, NULL, vectors, n_vectors, NULL,
+      0, G_SOCKET_MSG_NONE, NULL, error);
+}
+
+static gssize
+zik_socket_transport_receive (ZikTransport * transport, guint8 * buffer,
+    gsize size, GError ** error)
+{
+  ZikSocketTransport *self = (ZikSocketTransport *) transport;
+
+  return g_socket_receive (self->socket, (gchar *) buffer, size, NULL, error);
+}
+
+static gboolean
+zik_socket_watch_dispatch (GSocket * socket, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikTransportWatch *watch = (ZikTransportWatch *) userdata;
+
+  return watch->func (watch->transport, condition, watch->userdata);
+}
+
+static GSource *
+zik_socket_transport_create_watch (ZikTransport * transport,
+    GIOCondition condition, ZikTransportWatchFunc func, gpointer userdata,
+    GDestroyNotify notify)
+{
+  ZikSocketTransport *self = (ZikSocketTransport *) transport;
+  ZikTransportWatch *watch;
+  GSource *source;
+
+  watch = zik_transport_watch_new (transport, func, userdata, notify);
+
+  source = g_socket_create_source (self->socket, condition, NULL);
+  g_source_set_callback (source,
+      (GSourceFunc) (GCallback) zik_socket_watch_dispatch, watch,
+      (GDestroyNotify) zik_transport_watch_free);
+
+  return source;
+}
+
+static void
+zik_socket_transport_finalize (ZikTransport * transport)
+{
+  ZikSocketTransport *self = (ZikSocketTransport *) transport;
+
+  g_object_unref (self->socket);
+}
+
+static const ZikTransportFuncs zik_socket_transport_funcs = {
+  .send = zik_socket_transport_send,
+  .receive = zik_socket_transport_receive,
+  .create_watch = zik_socket_transport_create_watch,
+  .finalize = zik_socket_transport_finalize
+};
+
+/* @socket: a connected stream socket, made non-blocking */
+ZikTransport *
+zik_transport_new_for_socket (GSocket * socket)
+{
+  ZikSocketTransport *self;
+
+  g_socket_set_blocking (socket, FALSE);
+
+  self = zik_transport_new (&zik_socket_transport_funcs,
+      sizeof (ZikSocketTransport));
+  self->socket = g_object_ref (socket);
+
+  return (ZikTransport *) self;
+}
+
+/* @fd: a connected stream socket, closed with transport */
+ZikTransport *
+zik_transport_new_for_fd (gint fd)
+{
+  ZikTransport *transport;
+  GSocket *socket;
+  GError *error = NULL;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  if (socket == NULL) {
+    g_critical ("failed to create socket from fd %d: %s", fd, error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  transport = zik_transport_new_for_socket (socket);
+  g_object_unref (socket);
+
+  return transport;
+}
+
+/* Make two connected transports, what is sent on one is received on the
+ * other. Used to drive a connection without any bluetooth device */
+gboolean
+zik_transport_new_socketpair (ZikTransport ** transport, ZikTransport ** peer)
+{
+  gint fds[2];
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    g_critical ("failed to create socket pair: %s", g_strerror (errno));
+    return FALSE;
+  }
+
+  *transport = zik_transport_new_for_fd (fds[0]);
+  if (*transport == NULL) {
+    close (fds[0]);
+    close (fds[1]);
+    return FALSE;
+  }
+
+  *peer = zik_transport_new_for_fd (fds[1]);
+  if (*peer == NULL) {
+    zik_transport_unref (*transport);
+    close (fds[1]);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/** Shaping backend, delaying what is received from another transport to
+ * mimic a bluetooth link. Wrapping the device end of a socketpair delays
+ * requests, so answers come back after the whole round-trip time */
+
+typedef struct
+{
+  gint64 release;
+  gsize size;                   /* 0 for end of stream */
+  gsize offset;
+  GError *error;                /* end of stream caused by an error */
+  guint8 data[];
+} ZikShapedChunk;
+
+typedef struct
+{
+  ZikTransport parent;
+
+  ZikTransport *inner;
+  ZikTransportShaping shaping;
+  GRand *rand;
+  guint profile_index;
+
+  /* ZikShapedChunk received from inner transport, in release order */
+  GQueue chunks;
+  gint64 last_release;
+  gboolean eos;
+} ZikShapedTransport;
+
+typedef struct
+{
+  GSource source;
+
+  ZikShapedTransport *transport;
+} ZikShapedSource;
+
+static void
+zik_shaped_chunk_free (ZikShapedChunk * chunk)
+{
+  if (chunk->error)
+    g_error_free (chunk->error);
+
+  g_free (chunk);
+}
+
+/* Return: delay to apply on next chunk, in microseconds */
+static gint64
+zik_shaped_transport_next_delay (ZikShapedTransport * self)
+{
+  ZikTransportShaping *shaping = &self->shaping;
+  GArray *profile = shaping->latency_profile;
+  gdouble jitter = 0.0;
+  gint64 delay;
+
+  if (profile && profile->len > 0) {
+    delay = g_array_index (profile, guint, self->profile_index);
+    self->profile_index = (self->profile_index + 1) % profile->len;
+    return delay * 1000;
+  }
+
+  if (shaping->jitter > 0) {
+    gdouble u;
+
+    switch (shaping->distribution) {
+      case ZIK_TRANSPORT_JITTER_UNIFORM:
+        jitter = g_rand_double_range (self->rand, -1.0, 1.0);
+        break;
+      case ZIK_TRANSPORT_JITTER_NORMAL:
+        /* Box-Muller */
+        u = 1.0 - g_rand_double (self->rand);
+        jitter = sqrt (-2.0 * log (u)) *
+            cos (2.0 * G_PI * g_rand_double (self->rand));
+        break;
+      case ZIK_TRANSPORT_JITTER_EXPONENTIAL:
+        u = 1.0 - g_rand_double (self->rand);
+        jitter = -log (u);
+        break;
+    }
+  }
+
+  delay = (shaping->delay + jitter * shaping->jitter) * 1000;
+  return MAX (delay, 0);
+}
+
+static void
+zik_shaped_transport_push (ZikShapedTransport * self, const guint8 * data,
+    gsize size, GError * error)
+{
+  ZikTransportShaping *shaping = &self->shaping;
+  ZikShapedChunk *chunk;
+  gint64 release;
+  gint64 transmit = 0;
+  gsize split = 0;
+
+  if (size > 1 && shaping->split_probability > 0.0 &&
+      g_rand_double (self->rand) < shaping->split_probability)
+    split = g_rand_int_range (self->rand, 1, size);
+
+  if (shaping->bandwidth > 0)
+    transmit = size * G_USEC_PER_SEC / shaping->bandwidth;
+
+  /* keep stream ordered, a chunk can't overtake previous one */
+  release = g_get_monotonic_time () + zik_shaped_transport_next_delay (self);
+  release = MAX (release + transmit, self->last_release + transmit);
+
+  if (split) {
+    chunk = g_malloc (sizeof (ZikShapedChunk) + split);
+    chunk->release = release;
+    chunk->size = split;
+    chunk->offset = 0;
+    chunk->error = NULL;
+    memcpy (chunk->data, data, split);
+    g_queue_push_tail (&self->chunks, chunk);
+
+    data += split;
+    size -= split;
+    release += shaping->split_delay * 1000;
+  }
+
+  chunk = g_malloc (sizeof (ZikShapedChunk) + size);
+  chunk->release = release;
+  chunk->size = size;
+  chunk->offset = 0;
+  chunk->error = error;
+  memcpy (chunk->data, data, size);
+  g_queue_push_tail (&self->chunks, chunk);
+
+  self->last_release = release;
+}
+
+/* move whatever inner transport has to chunks */
+static void
+zik_shaped_transport_pump (ZikShapedTransport * self)
+{
+  guint8 buffer[4096];
+  GError *error = NULL;
+  gssize rbytes;
+
+  while (!self->eos) {
+    rbytes = zik_transport_receive (self->inner, buffer, sizeof (buffer),
+        &error);
+    if (rbytes < 0 && g_error_matches (error, G_IO_ERROR,
+            G_IO_ERROR_WOULD_BLOCK)) {
+      g_error_free (error);
+      return;
+    }
+
+    if (rbytes <= 0) {
+      /* end of stream is delayed as data is */
+      self->eos = TRUE;
+      zik_shaped_transport_push (self, NULL, 0, error);
+      return;
+    }
+
+    zik_shaped_transport_push (self, buffer, rbytes, NULL);
+  }
+}
+
+static gssize
+zik_shaped_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error)
+{
+  ZikShapedTransport *self = (ZikShapedTransport *) transport;
+
+  return zik_transport_send (self->inner, vectors, n_vectors, error);
+}
+
+static gssize
+zik_shaped_transport_receive (ZikTransport * transport, guint8 * buffer,
+    gsize size, GError ** error)
+{
+  ZikShapedTransport *self = (ZikShapedTransport *) transport;
+  ZikShapedChunk *chunk;
+  gsize n;
+
+  zik_shaped_transport_pump (self);
+
+  chunk = g_queue_peek_head (&self->chunks);
+  if (chunk == NULL || chunk->release > g_get_monotonic_time ()) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK,
+        "no data released yet");
+    return -1;
+  }
+
+  if (chunk->size == 0) {
+    /* end of stream, kept for further calls */
+    if (chunk->error) {
+      g_propagate_error (error, g_error_copy (chunk->error));
+      return -1;
+    }
+
+    return 0;
+  }
+
+  n = MIN (size, chunk->size - chunk->offset);
+  memcpy (buffer, chunk->data + chunk->offset, n);
+  chunk->offset += n;
+
+  if (chunk->offset == chunk->size)
+    zik_shaped_chunk_free (g_queue_pop_head (&self->chunks));
+
+  return n;
+}
+
+static gboolean
+zik_shaped_source_prepare (GSource * source, gint * timeout)
+{
+  ZikShapedSource *ssource = (ZikShapedSource *) source;
+  ZikShapedChunk *chunk;
+  gint64 now;
+
+  chunk = g_queue_peek_head (&ssource->transport->chunks);
+  if (chunk == NULL) {
+    *timeout = -1;
+    return FALSE;
+  }
+
+  now = g_source_get_time (source);
+  if (chunk->release <= now) {
+    *timeout = 0;
+    return TRUE;
+  }
+
+  *timeout = (chunk->release - now + 999) / 1000;
+  return FALSE;
+}
+
+static gboolean
+zik_shaped_source_check (GSource * source)
+{
+  ZikShapedSource *ssource = (ZikShapedSource *) source;
+  ZikShapedChunk *chunk;
+
+  chunk = g_queue_peek_head (&ssource->transport->chunks);
+
+  return chunk && chunk->release <= g_source_get_time (source);
+}
+
+static gboolean
+zik_shaped_source_dispatch (GSource * source, GSourceFunc callback,
+    gpointer userdata)
+{
+  ZikShapedSource *ssource = (ZikShapedSource *) source;
+  ZikTransportWatchFunc func = (ZikTransportWatchFunc) (GCallback) callback;
+
+  if (func == NULL)
+    return G_SOURCE_REMOVE;
+
+  return func ((ZikTransport *) ssource->transport, G_IO_IN, userdata);
+}
+
+static void
+zik_shaped_source_finalize (GSource * source)
+{
+  ZikShapedSource *ssource = (ZikShapedSource *) source;
+
+  zik_transport_unref ((ZikTransport *) ssource->transport);
+}
+
+static GSourceFuncs zik_shaped_source_funcs = {
+  zik_shaped_source_prepare,
+  zik_shaped_source_check,
+  zik_shaped_source_dispatch,
+  zik_shaped_source_finalize,
+  NULL, NULL
+};
+
+static gboolean
+zik_shaped_transport_on_inner_input (ZikTransport * inner,
+    GIOCondition condition, gpointer userdata)
+{
+  ZikShapedTransport *self = (ZikShapedTransport *) userdata;
+
+  zik_shaped_transport_pump (self);
+
+  return self->eos ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+}
+
+static gboolean
+zik_shaped_watch_dispatch (ZikTransport * inner, GIOCondition condition,
+    gpointer userdata)
+{
+  ZikTransportWatch *watch = (ZikTransportWatch *) userdata;
+
+  return watch->func (watch->transport, condition, watch->userdata);
+}
+
+static GSource *
+zik_shaped_transport_create_watch (ZikTransport * transport,
+    GIOCondition condition, ZikTransportWatchFunc func, gpointer userdata,
+    GDestroyNotify notify)
+{
+  ZikShapedTransport *self = (ZikShapedTransport *) transport;
+  ZikShapedSource *ssource;
+  GSource *source;
+  GSource *child;
+
+  if (!(condition & G_IO_IN)) {
+    /* sending is not shaped */
+    ZikTransportWatch *watch;
+
+    watch = zik_transport_watch_new (transport, func, userdata, notify);
+    return zik_transport_create_watch (self->inner, condition,
+        zik_shaped_watch_dispatch, watch,
+        (GDestroyNotify) zik_transport_watch_free);
+  }
+
+  source = g_source_new (&zik_shaped_source_funcs, sizeof (ZikShapedSource));
+  ssource = (ZikShapedSource *) source;
+  ssource->transport = (ZikShapedTransport *) zik_transport_ref (transport);
+  g_source_set_callback (source, (GSourceFunc) (GCallback) func, userdata,
+      notify);
+
+  /* fill chunks as soon as inner transport has data, source being
+   * dispatched later on release */
+  if (!self->eos) {
+    child = zik_transport_create_watch (self->inner,
+        G_IO_IN | G_IO_HUP | G_IO_ERR, zik_shaped_transport_on_inner_input,
+        self, NULL);
+    g_source_add_child_source (source, child);
+    g_source_unref (child);
+  }
+
+  return source;
+}
+
+static void
+zik_shaped_transport_finalize (ZikTransport * transport)
+{
+  ZikShapedTransport *self = (ZikShapedTransport *) transport;
+  ZikShapedChunk *chunk;
+
+  while ((chunk = g_queue_pop_head (&self->chunks)))
+    zik_shaped_chunk_free (chunk);
+
+  if (self->shaping.latency_profile)
+    g_array_unref (self->shaping.latency_profile);
+
+  g_rand_free (self->rand);
+  zik_transport_unref (self->inner);
+}
+
+static const ZikTransportFuncs zik_shaped_transport_funcs = {
+  .send = zik_shaped_transport_send,
+  .receive = zik_shaped_transport_receive,
+  .create_watch = zik_shaped_transport_create_watch,
+  .finalize = zik_shaped_transport_finalize
+};
+
+/* Wrap @inner so that data received from it is released according to
+ * @shaping */
+ZikTransport *
+zik_transport_new_shaped (ZikTransport * inner,
+    const ZikTransportShaping * shaping)
+{
+  ZikShapedTransport *self;
+
+  self = zik_transport_new (&zik_shaped_transport_funcs,
+      sizeof (ZikShapedTransport));
+  self->inner = zik_transport_ref (inner);
+  self->shaping = *shaping;
+  g_queue_init (&self->chunks);
+
+  if (shaping->latency_profile)
+    g_array_ref (shaping->latency_profile);
+
+  if (shaping->seed)
+    self->rand = g_rand_new_with_seed (shaping->seed);
+  else
+    self->rand = g_rand_new ();
+
+  return (ZikTransport *) self;
+}
+
+/* Load delays recorded from a real device: one round-trip time in
+ * milliseconds per line, '#' starting a comment.
+ *
+ * Return: (transfer full): array of guint, NULL on error */
+GArray *
+zik_transport_load_latency_profile (const gchar * filename, GError ** error)
+{
+  GArray *profile;
+  gchar *contents;
+  gchar **lines;
+  guint i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return NULL;
+
+  profile = g_array_new (FALSE, FALSE, sizeof (guint));
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (i = 0; lines[i] != NULL; i++) {
+    gchar *line = g_strstrip (lines[i]);
+    gchar *end;
+    guint64 delay;
+
+    if (line[0] == '\0' || line[0] == '#')
+      continue;
+
+    delay = g_ascii_strtoull (line, &end, 10);
+    if (end == line || (*end != '\0' && *end != '#' && !g_ascii_isspace (*end))
+        || delay > G_MAXUINT) {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+          "%s:%u: invalid delay '%s'", filename, i + 1, line);
+      g_array_unref (profile);
+      profile = NULL;
+      break;
+    } else {
+      guint value = delay;
+      g_array_append_val (profile, value);
+    }
+  }
+
+  if (profile && profile->len == 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        "%s: no delay found", filename);
+    g_array_unref (profile);
+    profile = NULL;
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return profile;
+}
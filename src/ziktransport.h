@@ -0,0 +1,110 @@
+/* Zik2ctl
+ * Copyright (C) 2015 Aurélien Zanelli <aurelien.zanelli@darkosphere.fr>
+ *
+ * Zik2ctl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Zik2ctl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Zik2ctl. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZIK_TRANSPORT_H
+#define ZIK_TRANSPORT_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define ZIK_TRANSPORT_TYPE (zik_transport_get_type ())
+
+typedef struct _ZikTransport ZikTransport;
+typedef struct _ZikTransportFuncs ZikTransportFuncs;
+
+typedef gboolean (*ZikTransportWatchFunc) (ZikTransport * transport,
+    GIOCondition condition, gpointer userdata);
+
+/* Byte stream carrying messages to and from the device. Operations never
+ * block: they fail with G_IO_ERROR_WOULD_BLOCK and a watch tells when to
+ * try again */
+struct _ZikTransportFuncs
+{
+  gssize (*send) (ZikTransport * transport, GOutputVector * vectors,
+      gint n_vectors, GError ** error);
+  gssize (*receive) (ZikTransport * transport, guint8 * buffer, gsize size,
+      GError ** error);
+  GSource *(*create_watch) (ZikTransport * transport, GIOCondition condition,
+      ZikTransportWatchFunc func, gpointer userdata, GDestroyNotify notify);
+  void (*finalize) (ZikTransport * transport);
+};
+
+/* backends embed this structure at the beginning of their own one */
+struct _ZikTransport
+{
+  const ZikTransportFuncs *funcs;
+  gint ref_count;
+};
+
+GType zik_transport_get_type (void);
+
+gpointer zik_transport_new (const ZikTransportFuncs * funcs, gsize size);
+ZikTransport *zik_transport_ref (ZikTransport * transport);
+void zik_transport_unref (ZikTransport * transport);
+
+gssize zik_transport_send (ZikTransport * transport, GOutputVector * vectors,
+    gint n_vectors, GError ** error);
+gssize zik_transport_receive (ZikTransport * transport, guint8 * buffer,
+    gsize size, GError ** error);
+GSource *zik_transport_create_watch (ZikTransport * transport,
+    GIOCondition condition, ZikTransportWatchFunc func, gpointer userdata,
+    GDestroyNotify notify);
+
+typedef enum
+{
+  ZIK_TRANSPORT_JITTER_UNIFORM,
+  ZIK_TRANSPORT_JITTER_NORMAL,
+  ZIK_TRANSPORT_JITTER_EXPONENTIAL
+} ZikTransportJitter;
+
+/* Shaping of received data, delays are in milliseconds.
+ *
+ * delay: applied on every chunk of data
+ * jitter: added to delay, scaled by a sample of distribution: [-1, 1] for
+ *   uniform, standard deviation for normal and mean for exponential
+ * bandwidth: bytes per second, 0 for unlimited
+ * split_probability, split_delay: chance of a chunk being cut in two,
+ *   second part coming split_delay later
+ * latency_profile: guint delays replayed in turn instead of delay/jitter
+ * seed: of random generator, 0 for a random one */
+typedef struct
+{
+  guint delay;
+  guint jitter;
+  ZikTransportJitter distribution;
+  guint bandwidth;
+  gdouble split_probability;
+  guint split_delay;
+  GArray *latency_profile;
+  guint32 seed;
+} ZikTransportShaping;
+
+/* backends */
+ZikTransport *zik_transport_new_for_socket (GSocket * socket);
+ZikTransport *zik_transport_new_for_fd (gint fd);
+gboolean zik_transport_new_socketpair (ZikTransport ** transport,
+    ZikTransport ** peer);
+ZikTransport *zik_transport_new_shaped (ZikTransport * inner,
+    const ZikTransportShaping * shaping);
+GArray *zik_transport_load_latency_profile (const gchar * filename,
+    GError ** error);
+
+G_END_DECLS
+
+#endif